@@ -50,6 +50,37 @@ char *urbildGBFile(resol_t *resol, long n)
   return buffer;
 }
 
+/******************************************************************************/
+char *checkpointFile(resol_t *resol, long n)
+/* String returned must be used at once, never reused, never freed. */
+/* Checkpoint of the Groebner basis computation for d_n, which yields d_{n+1} */
+{
+  static char buffer[MAXLINE];
+  sprintf(buffer, "%sd%02ld.ckp", resol->stem, n);
+  return buffer;
+}
+
+/******************************************************************************/
+char *buchbergerLogFile(resol_t *resol, long n)
+/* String returned must be used at once, never reused, never freed. */
+/* Rounds of the Groebner basis computation for d_n, see logBuchbergerRound */
+{
+  static char buffer[MAXLINE];
+  sprintf(buffer, "%sd%02ld.log", resol->stem, n);
+  return buffer;
+}
+
+/******************************************************************************/
+char *statisticsFile(resol_t *resol, long n)
+/* String returned must be used at once, never reused, never freed. */
+/* Counters of the Groebner basis computation that yielded d_n, see
+ * saveBuchbergerStatistics */
+{
+  static char buffer[MAXLINE];
+  sprintf(buffer, "%sd%02ld.json", resol->stem, n);
+  return buffer;
+}
+
 /******************************************************************************/
 char *resolDir(long Gsize)
 /* String returned must be used at once, never reused, never freed. */
@@ -252,17 +283,20 @@ int setRankProjCoverForModule(resol_t *resol, long rkP0, long dimM)
 /****
  * NULL on error
  ***************************************************************************/
-nRgs_t *urbildSetup(resol_t *resol, long n, PTR mat, long numnor)
-/* mat should be a block of length numnor = num * nor */
+static nRgs_t *stemmedUrbildSetup(resol_t *resol, long n, char *thisStem,
+  PTR mat, long numnor)
+/* urbildSetup, with the slices of the products stored under thisStem */
 {
-  char thisStem[MAXLINE];
   nRgs_t *nRgs;
   ngs_t *ngs;
-  group_t *group = resol->group;
   long r = rankProj(resol, n-1);
   if (r==-1) return NULL;
   long s = rankProj(resol, n);
   if (s==-1) return NULL;
+  long rank = dimIm(resol, n);
+  if (rank == -1) return NULL;
+  long kerRank = dimIm(resol, n+1);
+  if (kerRank == -1) return NULL;
   long nor = r+s;
   long num = numnor / nor;
   if (numnor != num * nor)
@@ -270,24 +304,13 @@ nRgs_t *urbildSetup(resol_t *resol, long n, PTR mat, long numnor)
       MTX_ERROR("Theoretical Error");
       return NULL;
   }
-  sprintf(thisStem, "%sd%ldu", resol->stem, n);
-  nRgs = nRgsAllocation(group, r, s, thisStem);
+  nRgs = nRgsAllocation(resol->group, r, s, thisStem);
   if (!nRgs) return NULL;
   ngs = nRgs->ngs;
   ngs->expDim = NO_BUCHBERGER_REQUIRED;
-  ngs->targetRank = dimIm(resol, n);
-  if (ngs->targetRank == -1)
-  {
-      freeNRgs(nRgs);
-      return NULL;
-  }
-  nRgs->ker->ngs->targetRank = dimIm(resol, n+1);
-  if (nRgs->ker->ngs->targetRank == -1)
-  {
-      freeNRgs(nRgs);
-      return NULL;
-  }
-  if (nRgsAssertReducedVectors(nRgs, mat, num, group))
+  ngs->targetRank = rank;
+  nRgs->ker->ngs->targetRank = kerRank;
+  if (nRgsAssertReducedVectors(nRgs, mat, num, resol->group))
   {
       freeNRgs(nRgs);
       return NULL;
@@ -295,6 +318,35 @@ nRgs_t *urbildSetup(resol_t *resol, long n, PTR mat, long numnor)
   return nRgs;
 }
 
+/****
+ * NULL on error
+ ***************************************************************************/
+nRgs_t *urbildSetup(resol_t *resol, long n, PTR mat, long numnor)
+/* mat should be a block of length numnor = num * nor */
+{
+  char thisStem[MAXLINE];
+  sprintf(thisStem, "%sd%ldu", resol->stem, n);
+  return stemmedUrbildSetup(resol, n, thisStem, mat, numnor);
+}
+
+static long keptSlicesSerial = 0;
+
+/****
+ * NULL on error
+ ***************************************************************************/
+static nRgs_t *keptUrbildSetup(resol_t *resol, long n, PTR mat, long numnor)
+/* urbildSetup, keeping the products of the slices (see keepStoredSlices).
+ * Each call gets a stem of its own, so that removeKeptSlices never touches
+ * the .stp files of another engine on the same degree. */
+{
+  char thisStem[MAXLINE];
+  nRgs_t *nRgs;
+  sprintf(thisStem, "%sd%ldu%ld_", resol->stem, n, ++keptSlicesSerial);
+  nRgs = stemmedUrbildSetup(resol, n, thisStem, mat, numnor);
+  if (nRgs) keepStoredSlices(nRgs->ngs);
+  return nRgs;
+}
+
 /****
  * NULL on error
  ***************************************************************************/
@@ -406,16 +458,58 @@ Matrix_t *makeFirstDifferential(resol_t *resol)
 /****
  * NULL on error
  ***************************************************************************/
-nRgs_t *loadDifferential(resol_t *resol, long n)
+static nRgs_t *resumedDifferential(resol_t *resol, long n)
+/* As nRgsStandardSetup would have left it, but in the state recorded in
+ * the checkpoint */
 {
+  char thisStem[MAXLINE];
+  group_t *group = resol->group;
+  long r = rankProj(resol, n-1);
+  if (r==-1) return NULL;
+  long s = rankProj(resol, n);
+  if (s==-1) return NULL;
   nRgs_t *nRgs;
-  Matrix_t *pres = MatLoad(differentialFile(resol, n));
-  if (!pres)
-  { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+  sprintf(thisStem, "%sd%ld", resol->stem, n);
+  nRgs = nRgsAllocation(group, r, s, thisStem);
+  if (!nRgs) return NULL;
+  nRgs->ngs->targetRank = dimIm(resol, n);
+  nRgs->ker->ngs->targetRank = dimIm(resol, n+1);
+  if (nRgs->ngs->targetRank == -1 || nRgs->ker->ngs->targetRank == -1)
+  { freeNRgs(nRgs);
+    MTX_ERROR("targetRank == -1: Theoretical error");
     return NULL;
   }
-  nRgs = nRgsStandardSetup(resol, n, pres->Data);
-  MatFree(pres);
+  if (loadNRgsCheckpoint(nRgs, group, checkpointFile(resol, n)))
+  { freeNRgs(nRgs);
+    return NULL;
+  }
+  return nRgs;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+nRgs_t *loadDifferential(resol_t *resol, long n)
+/* Resumes from the checkpoint, if there is one */
+{
+  nRgs_t *nRgs;
+  if (fileExists(checkpointFile(resol, n)))
+    nRgs = resumedDifferential(resol, n);
+  else
+  {
+    Matrix_t *pres = MatLoad(differentialFile(resol, n));
+    if (!pres)
+    { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+      return NULL;
+    }
+    nRgs = nRgsStandardSetup(resol, n, pres->Data);
+    MatFree(pres);
+  }
+  if (nRgs)
+  {
+    strcpy(nRgs->checkpoint, checkpointFile(resol, n));
+    strcpy(nRgs->roundLog, buchbergerLogFile(resol, n));
+  }
   return nRgs;
 }
 
@@ -498,12 +592,98 @@ int innerPreimages(nRgs_t *nRgs, PTR images, long num, group_t *group,
       uv = unreducedVector(ngs, gv);
       if (!uv) return 1;
       uv->index = i;
-      insertUnreducedVector(ngs, uv);
+      if (insertUnreducedVector(ngs, uv)) return 1;
     }
   }
   return urbildAufnahme(nRgs, group, preimages);
 }
 
+/****
+ * NULL on error
+ ***************************************************************************/
+preimEngine_t *newPreimageEngine(resol_t *resol, long n)
+/* Loads the urbild Groebner basis for d_n once, for many calls of
+ * enginePreimages. The products of its slices are kept from one call to
+ * the next; .stp files among them are removed by freePreimageEngine.
+ * An engine is not thread-safe: like all MeatAxe use, it belongs to one
+ * thread. */
+{
+  preimEngine_t *engine = (preimEngine_t *) malloc(sizeof(preimEngine_t));
+  if (!engine)
+  { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  Matrix_t *ugb = MatLoad(urbildGBFile(resol, n));
+  if (!ugb)
+  { free(engine);
+    return NULL;
+  }
+  engine->nRgs = keptUrbildSetup(resol, n, ugb->Data, ugb->Nor);
+  MatFree(ugb);
+  if (!engine->nRgs)
+  { free(engine);
+    return NULL;
+  }
+  engine->group = resol->group;
+  engine->n = n;
+  engine->calls = engine->images = engine->zeroImages = 0;
+  engine->seconds = 0;
+  return engine;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int enginePreimages(preimEngine_t *engine, PTR images, long num,
+  PTR preimages)
+/* As innerPreimages. After an error, the engine may only be freed. */
+{
+  struct timespec start, stop;
+  int r;
+  long i, j, rows = engine->nRgs->ngs->r;
+  FEL f;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < num; i++)
+  {
+    for (j = 0; j < rows; j++)
+      if (FfFindPivot(FfGetPtr(images, i * rows + j), &f) >= 0) break;
+    if (j == rows) engine->zeroImages++;
+  }
+  r = innerPreimages(engine->nRgs, images, num, engine->group, preimages);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  engine->seconds += (stop.tv_sec - start.tv_sec) +
+    1e-9 * (stop.tv_nsec - start.tv_nsec);
+  engine->calls++;
+  engine->images += num;
+  return r;
+}
+
+/******************************************************************************/
+void printPreimageEngineStatistics(preimEngine_t *engine, FILE *fp)
+{
+  ngs_t *ngs = engine->nRgs->ngs;
+  fprintf(fp, "Preimages under d_%ld: %lu images (%lu zero) in %lu calls, "
+    "%.3f s", engine->n, engine->images, engine->zeroImages, engine->calls,
+    engine->seconds);
+  if (engine->seconds > 0)
+    fprintf(fp, " (%.1f images/s)", engine->images / engine->seconds);
+  fprintf(fp, "\n  products computed %lu, reused %lu; block cache hits %lu, "
+    "misses %lu\n", ngs->productsComputed, ngs->productsReused,
+    ngs->cacheHits, ngs->cacheMisses);
+  return;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int freePreimageEngine(preimEngine_t *engine)
+{
+  int r = removeKeptSlices(engine->nRgs->ngs);
+  freeNRgs(engine->nRgs);
+  free(engine);
+  return r;
+}
+
 /****
  * 1 on error
  ***************************************************************************/
@@ -520,8 +700,14 @@ int makeThisDifferential(resol_t *resol, long n)
       return 1;
   }
   if (saveMinimalGenerators(ker, differentialFile(resol, n), G)) return 1;
+  saveBuchbergerStatistics(nRgs, statisticsFile(resol, n));
   if (saveUrbildGroebnerBasis(nRgs, urbildGBFile(resol, n-1), G)) return 1;
   freeNRgs(nRgs);
+  if (fileExists(checkpointFile(resol, n-1)) &&
+      remove(checkpointFile(resol, n-1)))
+  { MTX_ERROR1("Cannot remove file %s", checkpointFile(resol, n-1));
+    return 1;
+  }
   return 0;
 }
 
@@ -531,9 +717,14 @@ int makeThisDifferential(resol_t *resol, long n)
 static int makeThisCohringDifferential(resol_t *resol, long n)
 /* Know resolving trivial mod, so can use makeFirstDifferential if n=1 */
 {
-  if (n == 1)
-    return (makeFirstDifferential(resol))? 0 : 1;
-  return makeThisDifferential(resol, n);
+  Matrix_t *d1;
+  int r;
+  if (n != 1) return makeThisDifferential(resol, n);
+  d1 = makeFirstDifferential(resol);
+  if (!d1) return 1;
+  r = MatSave(d1, differentialFile(resol, 1));
+  MatFree(d1);
+  return r ? 1 : 0;
 }
 
 /*****
@@ -555,14 +746,26 @@ int readOrConstructThisProjective(resol_t *resol, long n)
   }
 }
 
-/***
+/****
  * 1 on error
- ****************************************************************************/
-int ensureThisProjectiveKnown(resol_t *resol, long n)
+ ***************************************************************************/
+static int remakeUrbildGroebnerBasis(resol_t *resol, long n)
+/* For n < resol->numproj, when d_{n+1} is known but dn.ugb is not */
 {
-  long d;
-  while ((d = resol->numproj + 1) <= n)
-    if (readOrConstructThisProjective(resol, d)) return 1;
+  group_t *G = resol->group;
+  nRgs_t *nRgs = loadDifferential(resol, n);
+  if (!nRgs) return 1;
+  if (nRgsBuchberger(nRgs, G) ||
+      saveUrbildGroebnerBasis(nRgs, urbildGBFile(resol, n), G))
+  {
+    freeNRgs(nRgs);
+    return 1;
+  }
+  freeNRgs(nRgs);
+  if (fileExists(checkpointFile(resol, n)) && remove(checkpointFile(resol, n)))
+  { MTX_ERROR1("Cannot remove file %s", checkpointFile(resol, n));
+    return 1;
+  }
   return 0;
 }
 
@@ -576,6 +779,369 @@ int ensureThisUrbildGBKnown(resol_t *resol, long n)
     return 1;
   }
   if (fileExists(urbildGBFile(resol, n))) return 0;
+  if (n < resol->numproj) return remakeUrbildGroebnerBasis(resol, n);
   return makeThisDifferential(resol, n+1);
 }
 
+/******************************************************************************
+ * The resolution pipeline. The kernel computations for successive degrees
+ * depend on each other, but once d_{n+1} is known, the urbild Groebner basis
+ * of d_n need not be on disk before the thread that owns the resolution
+ * record goes on with d_{n+2}. The owner collects its rows and writes the
+ * header of the file; writing the rows is left to a bounded pool of workers.
+ * Since the MeatAxe field parameters are global, the workers only do file
+ * I/O: all MeatAxe work, preimages included, is done by the owner.
+ ******************************************************************************/
+
+/******************************************************************************/
+static void freePipelineJob(pipeJob_t *job)
+{
+  if (job->fp) fclose(job->fp);
+  if (job->rows) free(job->rows);
+  free(job);
+  return;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeQueuedUrbildGB(pipeJob_t *job)
+/* Via a temporary file: ugbFile is complete once it exists. Calls no MeatAxe
+ * function, not even to report an error; the owner does that. */
+{
+  long i;
+  boolean failed = false;
+  if (job->rowSize == job->rowSizeIo)
+    failed = (fwrite(job->rows, job->rowSize, job->nor, job->fp) !=
+      (size_t) job->nor);
+  else
+    for (i = 0; i < job->nor && !failed; i++)
+      failed = (fwrite(job->rows + i * job->rowSize, job->rowSizeIo, 1,
+        job->fp) != 1);
+  if (fclose(job->fp)) failed = true;
+  job->fp = NULL;
+  if (failed || rename(job->tmpFile, job->ugbFile))
+  {
+    remove(job->tmpFile);
+    return 1;
+  }
+  if (fileExists(job->checkpoint) && remove(job->checkpoint)) return 1;
+  return 0;
+}
+
+/******************************************************************************/
+static void *pipelineWorker(void *arg)
+{
+  resolPipe_t *pipe = (resolPipe_t *) arg;
+  pipeJob_t *job;
+  int r;
+  pthread_mutex_lock(&pipe->lock);
+  for (;;)
+  {
+    job = pipe->first;
+    if (!job)
+    {
+      if (pipe->shutdown) break;
+      pthread_cond_wait(&pipe->changed, &pipe->lock);
+      continue;
+    }
+    pipe->first = job->next;
+    if (!pipe->first) pipe->last = NULL;
+    pthread_mutex_unlock(&pipe->lock);
+    r = writeQueuedUrbildGB(job);
+    pthread_mutex_lock(&pipe->lock);
+    if (r && !pipe->failed)
+    {
+      pipe->failed = true;
+      strcpy(pipe->failure, job->ugbFile);
+    }
+    pipe->pending--;
+    freePipelineJob(job);
+    pthread_cond_broadcast(&pipe->changed);
+  }
+  pthread_mutex_unlock(&pipe->lock);
+  return NULL;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+resolPipe_t *newResolutionPipeline(resol_t *resol, long workers)
+/* Starts workers threads. Only the thread that owns resol may use the
+ * pipeline, and must not change resol other than through
+ * pipelineEnsureProjective until finishResolutionPipeline. The workers
+ * never use the MeatAxe, so the owner is free to meanwhile. */
+{
+  resolPipe_t *pipe;
+  if (workers < 1)
+  { MTX_ERROR1("%E", MTX_ERR_BADARG);
+    return NULL;
+  }
+  pipe = (resolPipe_t *) malloc(sizeof(resolPipe_t));
+  if (!pipe)
+  { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  pipe->thread = (pthread_t *) malloc(workers * sizeof(pthread_t));
+  if (!pipe->thread)
+  {
+    free(pipe);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  pipe->resol = resol;
+  pipe->first = pipe->last = NULL;
+  pipe->pending = 0;
+  pipe->requests = NULL;
+  pipe->shutdown = pipe->failed = false;
+  pipe->failure[0] = '\0';
+  pthread_mutex_init(&pipe->lock, NULL);
+  pthread_cond_init(&pipe->changed, NULL);
+  for (pipe->workers = 0; pipe->workers < workers; pipe->workers++)
+    if (pthread_create(pipe->thread + pipe->workers, NULL, pipelineWorker,
+          pipe))
+      break;
+  /* Fewer workers than asked for are fine, none is not */
+  if (!pipe->workers)
+  {
+    finishResolutionPipeline(pipe);
+    MTX_ERROR("Cannot start a pipeline worker");
+    return NULL;
+  }
+  return pipe;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int queuePreimages(resolPipe_t *pipe, long n, PTR images, long num,
+  PTR preimages)
+/* Preimages under d_n, as innerPreimages computes them: preimages must be
+ * initialized to zero. They are computed by pipelineEnsureProjective as
+ * soon as it has the urbild Groebner basis for d_n, and otherwise by
+ * finishResolutionPipeline, which makes dn.ugb first if need be. */
+{
+  preimReq_t *req, **last;
+  if (n < 1)
+  { MTX_ERROR1("%E", MTX_ERR_BADARG);
+    return 1;
+  }
+  req = (preimReq_t *) malloc(sizeof(preimReq_t));
+  if (!req)
+  { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  req->n = n;
+  req->images = images;
+  req->preimages = preimages;
+  req->num = num;
+  req->next = NULL;
+  for (last = &pipe->requests; *last; last = &(*last)->next);
+  *last = req;
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int answerPreimageRequests(resolPipe_t *pipe, long n, PTR ugb,
+  long nor)
+/* Computes the preimages for all requests under d_n, given the nor rows of
+ * the urbild Groebner basis, and drops these requests. The products of its
+ * slices are computed once for all of them. */
+{
+  resol_t *resol = pipe->resol;
+  preimReq_t **prev, *req;
+  nRgs_t *nRgs;
+  int r = 0;
+  for (req = pipe->requests; req && req->n != n; req = req->next);
+  if (!req) return 0;
+  nRgs = keptUrbildSetup(resol, n, ugb, nor);
+  if (!nRgs) return 1;
+  for (prev = &pipe->requests; (req = *prev); )
+  {
+    if (req->n != n)
+    {
+      prev = &req->next;
+      continue;
+    }
+    if (!r) r = innerPreimages(nRgs, req->images, req->num, resol->group,
+      req->preimages);
+    *prev = req->next;
+    free(req);
+  }
+  if (removeKeptSlices(nRgs->ngs)) r = 1;
+  freeNRgs(nRgs);
+  return r;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int answerRemainingRequests(resolPipe_t *pipe)
+/* Once the workers are done. dn.ugb may still be missing, notably when
+ * dn+1.bin existed before the pipeline started; it is made then. */
+{
+  resol_t *resol = pipe->resol;
+  Matrix_t *ugb;
+  long n;
+  int r;
+  while (pipe->requests)
+  {
+    n = pipe->requests->n;
+    if (n > resol->numproj)
+    {
+      MTX_ERROR1("Urbild Groebner basis for d_%ld not known", n);
+      return 1;
+    }
+    if (ensureThisUrbildGBKnown(resol, n)) return 1;
+    ugb = MatLoad(urbildGBFile(resol, n));
+    if (!ugb)
+    { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+      return 1;
+    }
+    r = answerPreimageRequests(pipe, n, ugb->Data, ugb->Nor);
+    MatFree(ugb);
+    if (r) return 1;
+  }
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int pipelinedDifferential(resolPipe_t *pipe, long n)
+/* makeThisDifferential, leaving the rows of the urbild Groebner basis to be
+ * written by a worker */
+{
+  resol_t *resol = pipe->resol;
+  group_t *G = resol->group;
+  pipeJob_t *job;
+  char *rows;
+  long nor;
+  nRgs_t *nRgs = loadDifferential(resol, n-1);
+  if (!nRgs) return 1;
+  if (nRgsBuchberger(nRgs, G) ||
+      setRankProj(resol, n, numberOfHeadyVectors(nRgs->ker->ngs)) ||
+      saveMinimalGenerators(nRgs->ker, differentialFile(resol, n), G))
+  {
+    freeNRgs(nRgs);
+    return 1;
+  }
+  saveBuchbergerStatistics(nRgs, statisticsFile(resol, n));
+  rows = urbildGroebnerBasisRows(nRgs, &nor);
+  freeNRgs(nRgs);
+  if (!rows) return 1;
+  /* They are at hand now, rather than once d(n-1).ugb is written */
+  if (answerPreimageRequests(pipe, n-1, (PTR) rows, nor))
+  {
+    free(rows);
+    return 1;
+  }
+  job = (pipeJob_t *) malloc(sizeof(pipeJob_t));
+  if (!job)
+  {
+    free(rows);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  job->n = n-1;
+  job->rows = rows;
+  job->nor = nor;
+  job->rowSize = FfCurrentRowSize;
+  job->rowSizeIo = FfCurrentRowSizeIo;
+  job->next = NULL;
+  strcpy(job->ugbFile, urbildGBFile(resol, n-1));
+  strcpy(job->checkpoint, checkpointFile(resol, n-1));
+  sprintf(job->tmpFile, "%s.tmp", job->ugbFile);
+  job->fp = writehdrplus(job->tmpFile, FfOrder, nor, G->nontips);
+  if (!job->fp)
+  {
+    freePipelineJob(job);
+    return 1;
+  }
+  pthread_mutex_lock(&pipe->lock);
+  /* Each pending job holds a whole urbild Groebner basis: at most one per
+   * worker */
+  while (pipe->pending >= pipe->workers && !pipe->failed)
+    pthread_cond_wait(&pipe->changed, &pipe->lock);
+  if (pipe->last) pipe->last->next = job;
+  else pipe->first = job;
+  pipe->last = job;
+  pipe->pending++;
+  pthread_cond_broadcast(&pipe->changed);
+  pthread_mutex_unlock(&pipe->lock);
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int pipelineEnsureProjective(resolPipe_t *pipe, long N)
+/* ensureThisProjectiveKnown, while the workers write the urbild Groebner
+ * bases. A worker's failure is reported by finishResolutionPipeline. */
+{
+  resol_t *resol = pipe->resol;
+  long d;
+  boolean failed;
+  while ((d = resol->numproj + 1) <= N)
+  {
+    pthread_mutex_lock(&pipe->lock);
+    failed = pipe->failed;
+    pthread_mutex_unlock(&pipe->lock);
+    if (failed) return 1;
+    if (d == 1 || fileExists(differentialFile(resol, d)))
+    {
+      if (readOrConstructThisProjective(resol, d)) return 1;
+    }
+    else if (pipelinedDifferential(pipe, d)) return 1;
+  }
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int finishResolutionPipeline(resolPipe_t *pipe)
+/* Waits until the workers have written all urbild Groebner bases, answers
+ * the preimage requests not answered yet, then frees pipe. Returns 1 if a
+ * worker failed, or a request could not be answered. */
+{
+  preimReq_t *req;
+  long w;
+  int r = 0;
+  pthread_mutex_lock(&pipe->lock);
+  pipe->shutdown = true;
+  pthread_cond_broadcast(&pipe->changed);
+  pthread_mutex_unlock(&pipe->lock);
+  for (w = 0; w < pipe->workers; w++)
+    pthread_join(pipe->thread[w], NULL);
+  if (pipe->failed)
+  {
+    MTX_ERROR1("Cannot save %s", pipe->failure);
+    r = 1;
+  }
+  if (answerRemainingRequests(pipe)) r = 1;
+  while ((req = pipe->requests))
+  {
+    pipe->requests = req->next;
+    free(req);
+  }
+  pthread_mutex_destroy(&pipe->lock);
+  pthread_cond_destroy(&pipe->changed);
+  free(pipe->thread);
+  free(pipe);
+  return r;
+}
+
+/***
+ * 1 on error
+ ****************************************************************************/
+int ensureThisProjectiveKnown(resol_t *resol, long n)
+{
+  long d;
+  while ((d = resol->numproj + 1) <= n)
+    if (readOrConstructThisProjective(resol, d)) return 1;
+  return 0;
+}
+
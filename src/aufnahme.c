@@ -76,6 +76,7 @@ static int demoteReducedVector(ngs_t *ngs, rV_t *rv)
   if (insertNewUnreducedVector(ngs, rv->gv)) return 1;
   rv->gv = NULL;
   freeReducedVector(rv, ngs);
+  ngs->stats.demotions++;
   return 0;
 }
 
@@ -88,6 +89,7 @@ static int markNodeMultiples(ngs_t *ngs, rV_t *rv, modW_t *node,
   /* node != NULL guaranteed */
   /* know: node represents tip(rv) * ext */
   register long a;
+  modW_t *child;
   rV_t *v = node->divisor;
   boolean aF = alreadyFound;
   if (!alreadyFound && v != NULL)
@@ -103,13 +105,32 @@ static int markNodeMultiples(ngs_t *ngs, rV_t *rv, modW_t *node,
   if (!aF) ngs->pnontips--;
   for (a = 0; a < group->arrows; a++)
   {
-    if (!node->child[a]) continue;
-    node->child[a]->parent = node;
-    if (markNodeMultiples(ngs, rv, node->child[a], aF, ext->child[a], group)) return 1;
+    child = wordForestChild(ngs, group, node, a);
+    if (!child) continue;
+    child->parent = node;
+    if (markNodeMultiples(ngs, rv, child, aF, ext->child[a], group)) return 1;
   }
   return 0;
 }
 
+/*****
+ * NULL on error
+ **************************************************************************/
+rV_t *assertReducedVector(ngs_t *ngs, gV_t *gv, group_t *group)
+/* gv, known to be reduced, joins the reduced vectors and marks its tip */
+{
+  modW_t *ptn;
+  rV_t *rv;
+  findLeadingMonomial(gv, ngs->r, group);
+  ptn = wordForestEntry(ngs, gv);
+  rv = reducedVector(gv, group, ngs);
+  if (!rv) return NULL;
+  rv->node = ptn;
+  if (insertReducedVector(ngs, rv)) return NULL;
+  if (markNodeMultiples(ngs, rv, ptn, false, group->root, group)) return NULL;
+  return rv;
+}
+
 /*****
  * 1 on error
  **************************************************************************/
@@ -118,8 +139,6 @@ int nRgsAssertReducedVectors(nRgs_t *nRgs, PTR mat, long num, group_t *group)
 {
   ngs_t *ngs = nRgs->ngs;
   register gV_t *gv;
-  register rV_t *rv;
-  modW_t *ptn;
   register long i;
   long nor = ngs->r + ngs->s;
   for (i = 0; i < num; i++)
@@ -127,15 +146,9 @@ int nRgsAssertReducedVectors(nRgs_t *nRgs, PTR mat, long num, group_t *group)
     gv = popGeneralVector(ngs);
     if (!gv) return 1;
     memcpy(gv->w, FfGetPtr(mat, i * nor), (FfCurrentRowSize*nor));
-    findLeadingMonomial(gv, ngs->r, group);
-    ptn = wordForestEntry(ngs, gv);
-    rv = reducedVector(gv, group);
-    if (!rv) return 1;
-    rv->node = ptn;
-    if (insertReducedVector(ngs, rv)) return 1;
-    if (markNodeMultiples(ngs, rv, ptn, false, group->root, group)) return 1;
+    if (!assertReducedVector(ngs, gv, group)) return 1;
   }
-  if (ngs->unreducedHeap)
+  if (ngs->numUnreduced)
   { MTX_ERROR("nRgsAssertRV: Theoretical error");
     return 1;
   }
@@ -149,12 +162,13 @@ static int promoteUnreducedVector(ngs_t *ngs, uV_t *uv, group_t *group)
 {
   modW_t *ptn = wordForestEntry(ngs, uv->gv);
   rV_t *rv;
-  rv = reducedVector(uv->gv, group);
+  rv = reducedVector(uv->gv, group, ngs);
   if (!rv) return 1;
   rv->node = ptn;
   uv->gv = NULL;
-  freeUnreducedVector(uv);
+  freeUnreducedVector(uv, ngs);
   if (insertReducedVector(ngs, rv)) return 1;
+  ngs->stats.promotions++;
   return markNodeMultiples(ngs, rv, ptn, false, group->root, group);
 }
 
@@ -164,6 +178,7 @@ void possiblyNewKernelGenerator(nRgs_t *nRgs, PTR pw, group_t *group)
   PTR pm = pw;
   pm = FfGetPtr(pm, nRgs->ngs->r);
   processNewFlaggedGenerator (nRgs->ker, pm, group);
+  nRgs->kernelGenerators++;
   return;
 }
 
@@ -177,11 +192,11 @@ static int nFgsProcessModifiedUnreducedVector(nFgs_t *nFgs, uV_t *uv,
   gV_t *gv = uv->gv;
   findLeadingMonomial(gv, ngs->r, group);
   if (gv->dim == ZERO_BLOCK)
-    freeUnreducedVector(uv);
+    freeUnreducedVector(uv, ngs);
   else
   {
     if (makeVectorMonic(ngs, gv)) return 1;
-    insertUnreducedVector(ngs, uv);
+    if (insertUnreducedVector(ngs, uv)) return 1;
   }
   return 0;
 }
@@ -197,12 +212,12 @@ static int nRgsProcessModifiedUnreducedVector(nRgs_t *nRgs, uV_t *uv, group_t *g
   if (gv->dim == ZERO_BLOCK)
   {
     possiblyNewKernelGenerator(nRgs, gv->w, group);
-    freeUnreducedVector(uv);
+    freeUnreducedVector(uv, ngs);
   }
   else
   {
     if (makeVectorMonic(ngs, gv)) return 1;
-    insertUnreducedVector(ngs, uv);
+    if (insertUnreducedVector(ngs, uv)) return 1;
   }
   return 0;
 }
@@ -224,9 +239,9 @@ static int urbildProcessModifiedUnreducedVector(nRgs_t *nRgs, uV_t *uv,
     src = FfGetPtr(gv->w, r);
     dest = FfGetPtr(result, uv->index * s);
     memcpy(dest, src, (FfCurrentRowSize*s));
-    freeUnreducedVector(uv);
+    freeUnreducedVector(uv, ngs);
   }
-  else insertUnreducedVector(ngs, uv);
+  else if (insertUnreducedVector(ngs, uv)) return 1;
   return 0;
 }
 
@@ -239,10 +254,11 @@ static int nFgsPerformLinearReductions(nFgs_t *nFgs, gV_t *gv0, group_t *group)
   register long nor = ngs->r + ngs->s;
   register gV_t *gv;
   register uV_t *uv;
-  while ((uv = unreducedSuccessor(ngs, NULL)) && (gv = uv->gv)->col == gv0->col
+  while ((uv = firstUnreducedVector(ngs)) && (gv = uv->gv)->col == gv0->col
     && gv->block == gv0->block)
   {
     unlinkUnreducedVector(ngs, uv);
+    ngs->stats.reductionsOfDim[gv->dim]++;
     subtract(gv->w, gv0->w,nor);
     if (nFgsProcessModifiedUnreducedVector(nFgs, uv, group)) return 1;
   }
@@ -258,10 +274,11 @@ static int nRgsPerformLinearReductions(nRgs_t *nRgs, gV_t *gv0, group_t *group)
   register long nor = ngs->r + ngs->s;
   register gV_t *gv;
   register uV_t *uv;
-  while ((uv = unreducedSuccessor(ngs, NULL)) && (gv = uv->gv)->col == gv0->col
+  while ((uv = firstUnreducedVector(ngs)) && (gv = uv->gv)->col == gv0->col
     && gv->block == gv0->block)
   {
     unlinkUnreducedVector(ngs, uv);
+    ngs->stats.reductionsOfDim[gv->dim]++;
     subtract(gv->w, gv0->w,nor);
     if (nRgsProcessModifiedUnreducedVector(nRgs, uv, group)) return 1;
   }
@@ -296,6 +313,7 @@ static int reduceMonicTipOnce(ngs_t *ngs, gV_t *gv, group_t *group)
   w = nodeVector(ngs, group, node);
   if (!w) return 1;
   nor = ngs->r + ngs->s;
+  ngs->stats.reductionsOfDim[gv->dim]++;
   subtract(gv->w, w, nor);
   return 0;
 }
@@ -315,6 +333,7 @@ static int reduceTipOnce(ngs_t *ngs, gV_t *gv, group_t *group)
   w = nodeVector(ngs, group, node);
   if (!w) return 1;
   nor = ngs->r + ngs->s;
+  ngs->stats.reductionsOfDim[gv->dim]++;
   submul(gv->w, w, gv->coeff, nor);
   return 0;
 }
@@ -327,6 +346,41 @@ static int tidyUpAfterAufnahme(ngs_t *ngs)
   return destroyCurrentDimensionIfAny(ngs);
 }
 
+/******************************************************************************/
+static inline boolean sweepCanStop(ngs_t *ngs, group_t *group, long sweepDim)
+/* The rank is right, and no heady vector lies at or beyond sweepDim. The
+ * unreduced vectors, which all lie there, can then neither be promoted nor
+ * be swapped in for a heady one (see shouldReduceTip): they would all
+ * reduce to zero. */
+{
+  return (easyCorrectRank(ngs, group) &&
+    dimensionOfDeepestHeady(ngs) < sweepDim) ? true : false;
+}
+
+/******************************************************************************/
+static inline boolean kernelSettled(nFgs_t *ker, group_t *group)
+/* nFgsBuchberger would find it finished, so that nRgsBuchberger would not
+ * look at further kernel elements */
+{
+  ngs_t *ngs = ker->ngs;
+  return (!ngs->numUnreduced && easyCorrectRank(ngs, group) &&
+    dimensionOfDeepestHeady(ngs) <= ngs->expDim) ? true : false;
+}
+
+/******************************************************************************/
+static void discardUnreducedVectors(ngs_t *ngs)
+/* See sweepCanStop */
+{
+  uV_t *uv;
+  while ((uv = firstUnreducedVector(ngs)))
+  {
+    unlinkUnreducedVector(ngs, uv);
+    freeUnreducedVector(uv, ngs);
+  }
+  return;
+}
+
+
 /*****
  * 1 on error
  **************************************************************************/
@@ -336,15 +390,17 @@ int nFgsAufnahme(nFgs_t *nFgs, group_t *group)
   register uV_t *uv;
   register gV_t *gv;
   long sweepDim;
-  if (!ngs->unreducedHeap)
+  struct timespec start;
+  if (!ngs->numUnreduced)
   {
     tidyUpAfterAufnahme(ngs);
     return 0;
   }
-  sweepDim = ngs->unreducedHeap->gv->dim;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sweepDim = firstUnreducedVector(ngs)->gv->dim;
   if (selectNewDimension(ngs, group, sweepDim)) return 1;
   for (; sweepDim <= group->maxlength; sweepDim++)
-  { uv = unreducedSuccessor(ngs, NULL);
+  { uv = firstUnreducedVector(ngs);
     while ((uv != NULL) && uv->gv->dim == sweepDim)
     {
       unlinkUnreducedVector(ngs, uv);
@@ -359,12 +415,14 @@ int nFgsAufnahme(nFgs_t *nFgs, group_t *group)
       {
         if (promoteUnreducedVector(ngs, uv, group)) return 1;
       }
-      uv = unreducedSuccessor(ngs, NULL);
+      if (sweepCanStop(ngs, group, sweepDim)) discardUnreducedVectors(ngs);
+      uv = firstUnreducedVector(ngs);
     }
     if (!uv) break; /* All unreduced vectors processed */
     else if (incrementSlice(ngs, group)) return 1;
   }
   tidyUpAfterAufnahme(ngs);
+  ngs->stats.seconds[PHASE_AUFNAHME] += secondsSince(&start);
   return 0;
 }
 
@@ -377,16 +435,18 @@ int urbildAufnahme(nRgs_t *nRgs, group_t *group, PTR result)
   register uV_t *uv;
   register gV_t *gv;
   register long sweepDim;
-  if (!ngs->unreducedHeap)
+  struct timespec start;
+  if (!ngs->numUnreduced)
   {
     tidyUpAfterAufnahme(ngs);
     return 0;
   }
-  sweepDim = ngs->unreducedHeap->gv->dim;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sweepDim = firstUnreducedVector(ngs)->gv->dim;
   if (selectNewDimension(ngs, group, sweepDim)) return 1;
   for (; sweepDim <= group->maxlength; sweepDim++)
   {
-    while ((uv = unreducedSuccessor(ngs, NULL)) && uv->gv->dim == sweepDim)
+    while ((uv = firstUnreducedVector(ngs)) && uv->gv->dim == sweepDim)
     {
       unlinkUnreducedVector(ngs, uv);
       gv = uv->gv;
@@ -404,6 +464,7 @@ int urbildAufnahme(nRgs_t *nRgs, group_t *group, PTR result)
     else if (incrementSlice(ngs, group)) return 1;
   }
   tidyUpAfterAufnahme(ngs);
+  ngs->stats.seconds[PHASE_AUFNAHME] += secondsSince(&start);
   return 0;
 }
 
@@ -416,16 +477,18 @@ int nRgsAufnahme(nRgs_t *nRgs, group_t *group)
   register uV_t *uv;
   register gV_t *gv;
   long sweepDim;
-  if (!ngs->unreducedHeap)
+  struct timespec start;
+  if (!ngs->numUnreduced)
   {
     tidyUpAfterAufnahme(ngs);
     return 0;
   }
-  sweepDim = ngs->unreducedHeap->gv->dim;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sweepDim = firstUnreducedVector(ngs)->gv->dim;
   if (selectNewDimension(ngs, group, sweepDim)) return 1;
   for (; sweepDim <= group->maxlength; sweepDim++)
   {
-    while ((uv = unreducedSuccessor(ngs, NULL)) && uv->gv->dim == sweepDim)
+    while ((uv = firstUnreducedVector(ngs)) && uv->gv->dim == sweepDim)
     {
       unlinkUnreducedVector(ngs, uv);
       gv = uv->gv;
@@ -439,10 +502,14 @@ int nRgsAufnahme(nRgs_t *nRgs, group_t *group)
       {
         if (promoteUnreducedVector(ngs, uv, group)) return 1;
       }
+      /* What kernel elements the rest would yield are of no interest */
+      if (sweepCanStop(ngs, group, sweepDim) && kernelSettled(nRgs->ker, group))
+        discardUnreducedVectors(ngs);
     }
     if (!uv) break; /* All unreduced vectors processed */
     else if (incrementSlice(ngs, group)) return 1;
   }
   tidyUpAfterAufnahme(ngs);
+  ngs->stats.seconds[PHASE_AUFNAHME] += secondsSince(&start);
   return 0;
 }
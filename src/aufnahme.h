@@ -30,6 +30,7 @@ int nFgsAufnahme(nFgs_t *nFgs, group_t *group);
 int nRgsAufnahme(nRgs_t *nRgs, group_t *group);
 int urbildAufnahme(nRgs_t *nRgs, group_t *group, PTR result);
 int nRgsAssertReducedVectors(nRgs_t *nRgs, PTR mat, long num, group_t *group);
+rV_t *assertReducedVector(ngs_t *ngs, gV_t *gv, group_t *group);
 void possiblyNewKernelGenerator(nRgs_t *nRgs, PTR pw, group_t *group);
 
 #endif
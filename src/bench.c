@@ -0,0 +1,452 @@
+/* ================================================================
+   bench.c : Benchmark of the resolution engine
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of p_group_cohomology.
+
+   p_group_cohomoloy is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   p_group_cohomoloy is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with p_group_cohomoloy.  If not, see <http://www.gnu.org/licenses/>.
+   ================================================================ */
+
+#include "modular_resolution.h"
+#include "aufloesung_decls.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define LONGLINE 320
+MTX_DEFINE_FILE_INFO
+
+static MtxApplicationInfo_t AppInfo = {
+    "benchmarkResolution",
+
+    "Time the resolution engine on a fixed corpus of groups",
+
+    "    For each group of the corpus, writes <dir>/<name>.reg and runs\n"
+    "    makeNontips, makeActionMatrices and a resolution up to degree N.\n"
+    "    Each phase runs in a process of its own. Prints one JSON object\n"
+    "    per phase and line: wall time, user and system time, peak RSS\n"
+    "    and the bytes of storage I/O, and the ranks for the resolution.\n"
+    "\n"
+    "SYNTAX\n"
+    "    benchmarkResolution [-b <bindir>] [-c <rows>] [-N <N>]\n"
+    "                        [-t <threads>] <dir> [<name> ...]\n"
+    "\n"
+    "ARGUMENTS\n"
+    "    <dir> .................. an empty directory for the files\n"
+    "    <name> ................. only these groups of the corpus\n"
+    "\n"
+    "OPTIONS\n"
+    MTX_COMMON_OPTIONS_DESCRIPTION
+    "    -b <bindir> ............ where makeNontips and makeActionMatrices\n"
+    "                             are (default .)\n"
+    "    -c <rows> .............. before each resolution, calibrate the block\n"
+    "                             size for products of <rows> rows, see\n"
+    "                             calibrateBlockSize (default: automatic)\n"
+    "    -N <N> ................. resolve up to degree N rather than up to\n"
+    "                             the degree given in the corpus\n"
+    "    -t <threads> ........... see setNumberOfThreads (default 1)\n"
+    "\n"
+    "CORPUS\n"
+    "    p=2: c2c2 c4c2 d8 e16 c8c2 u64\n"
+    "    p=3: c3c3 c9 h27\n"
+    "    p=5: c5c5 h125\n"
+    };
+
+static MtxApplication_t *App = NULL;
+
+/* How the elements of a corpus group are encoded */
+#define ABELIAN 0       /* product of cyclic groups of the given orders */
+#define UNITRIANGULAR 1 /* upper unitriangular n x n matrices over GF(p) */
+#define MAX_FACTORS 5
+
+struct benchGroup
+{
+  char *name;
+  long p;
+  int kind;
+  long n; /* number of cyclic factors, resp. size of the matrices */
+  long orders[MAX_FACTORS]; /* ABELIAN only */
+  long degree; /* resolved up to this degree */
+};
+
+static struct benchGroup corpus[] = {
+  {"c2c2", 2, ABELIAN, 2, {2, 2}, 12},
+  {"c4c2", 2, ABELIAN, 2, {4, 2}, 12},
+  {"d8", 2, UNITRIANGULAR, 3, {0}, 12},
+  {"e16", 2, ABELIAN, 4, {2, 2, 2, 2}, 8},
+  {"c8c2", 2, ABELIAN, 2, {8, 2}, 10},
+  {"u64", 2, UNITRIANGULAR, 4, {0}, 9},
+  {"c3c3", 3, ABELIAN, 2, {3, 3}, 10},
+  {"c9", 3, ABELIAN, 1, {9}, 10},
+  {"h27", 3, UNITRIANGULAR, 3, {0}, 8},
+  {"c5c5", 5, ABELIAN, 2, {5, 5}, 8},
+  {"h125", 5, UNITRIANGULAR, 3, {0}, 6},
+  {NULL, 0, 0, 0, {0}, 0}
+};
+
+/**
+ * Control variables
+ **/
+
+static const char *bindir = ".";
+static const char *dir = NULL;
+static long degree = -1;
+static long threads = 1;
+static long calibrationRows = 0;
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int Init(int argc, const char *argv[])
+{
+  App = AppAlloc(&AppInfo,argc,argv);
+  if (App == NULL)
+    return 1;
+  bindir = AppGetTextOption(App, "-b", ".");
+  calibrationRows = AppGetIntOption(App, "-c", 0, 1, 1000000);
+  degree = AppGetIntOption(App, "-N", -1, 1, 1000);
+  threads = AppGetIntOption(App, "-t", 1, 1, 1024);
+  if (AppGetArguments(App, 1, 1 + (sizeof(corpus) / sizeof(corpus[0]))) < 0)
+    return 1;
+  dir = App->ArgV[0];
+  return 0;
+}
+
+static void Cleanup()
+{
+    if (App != NULL)
+        AppFree(App);
+}
+
+/******************************************************************************/
+static boolean selected(struct benchGroup *g)
+{
+  int i;
+  if (App->ArgC == 1) return true;
+  for (i = 1; i < App->ArgC; i++)
+    if (!strcmp(App->ArgV[i], g->name)) return true;
+  return false;
+}
+
+/******************************************************************************
+ * The regular representation of a corpus group. Element x is given by its
+ * coordinates c[0], c[1], ...: those of an ABELIAN group in the cyclic
+ * factors, those of an UNITRIANGULAR group the entries above the diagonal,
+ * row by row. The identity is element 0.
+ ******************************************************************************/
+
+/******************************************************************************/
+static long numberOfCoordinates(struct benchGroup *g)
+{
+  return (g->kind == ABELIAN) ? g->n : g->n * (g->n - 1) / 2;
+}
+
+/******************************************************************************/
+static long coordinateOrder(struct benchGroup *g, long k)
+{
+  return (g->kind == ABELIAN) ? g->orders[k] : g->p;
+}
+
+/******************************************************************************/
+static long numberOfGenerators(struct benchGroup *g)
+{
+  return (g->kind == ABELIAN) ? g->n : g->n - 1;
+}
+
+/******************************************************************************/
+static long groupOrder(struct benchGroup *g)
+{
+  long k, order = 1;
+  for (k = 0; k < numberOfCoordinates(g); k++) order *= coordinateOrder(g, k);
+  return order;
+}
+
+/******************************************************************************/
+static long unitriangularEntry(struct benchGroup *g, long i, long j)
+/* Coordinate of entry (i,j), i < j */
+{
+  return i * g->n - i * (i + 1) / 2 + j - i - 1;
+}
+
+/******************************************************************************/
+static void rightMultiply(struct benchGroup *g, long *c, long a)
+/* c := c * generator a. Generator a of an UNITRIANGULAR group is
+ * I + E_{a,a+1}, which adds column a to column a+1 */
+{
+  long i;
+  if (g->kind == ABELIAN)
+  {
+    c[a] = (c[a] + 1) % g->orders[a];
+    return;
+  }
+  for (i = 0; i < a; i++)
+    c[unitriangularEntry(g, i, a+1)] =
+      (c[unitriangularEntry(g, i, a+1)] + c[unitriangularEntry(g, i, a)]) % g->p;
+  c[unitriangularEntry(g, a, a+1)] = (c[unitriangularEntry(g, a, a+1)] + 1) % g->p;
+  return;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int joinName(char *dest, const char *a, const char *sep,
+  const char *b)
+/* dest = a sep b, which must fit into MAXLINE chars */
+{
+  if (snprintf(dest, MAXLINE, "%s%s%s", a, sep, b) < MAXLINE) return 0;
+  MTX_ERROR1("%s: file name too long", a);
+  return 1;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeRegularRepresentation(struct benchGroup *g, char *stem)
+/* <stem>.reg, as read by loadRegularActionMatrices */
+{
+  char file[MAXLINE];
+  long order = groupOrder(g), gens = numberOfGenerators(g);
+  long ncoord = numberOfCoordinates(g);
+  long head[3], c[MAX_FACTORS * MAX_FACTORS], x, y, k, a;
+  FILE *fp;
+  if (joinName(file, stem, "", ".reg")) return 1;
+  fp = SysFopen(file, FM_CREATE);
+  if (!fp) return 1;
+  head[0] = -1;
+  head[1] = order;
+  head[2] = gens;
+  if (SysWriteLong(fp, head, 3) != 3)
+  { fclose(fp);
+    MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+    return 1;
+  }
+  for (a = 0; a < gens; a++)
+    for (x = 0; x < order; x++)
+    {
+      for (k = 0, y = x; k < ncoord; y /= coordinateOrder(g, k++))
+        c[k] = y % coordinateOrder(g, k);
+      rightMultiply(g, c, a);
+      for (k = ncoord - 1, y = 0; k >= 0; k--)
+        y = y * coordinateOrder(g, k) + c[k];
+      y++; /* loadGeneralRegularActionMatrices shifts by one */
+      if (SysWriteLong(fp, &y, 1) != 1)
+      { fclose(fp);
+        MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+        return 1;
+      }
+    }
+  fclose(fp);
+  return 0;
+}
+
+/******************************************************************************
+ * Measuring a phase
+ ******************************************************************************/
+
+struct phaseStats
+{
+  boolean ok;
+  double seconds;
+  struct rusage usage; /* of the process that ran the phase */
+  char output[LONGLINE]; /* what it wrote to its pipe, if anything */
+};
+
+/******************************************************************************/
+static double timevalSeconds(struct timeval *tv)
+{
+  return tv->tv_sec + 1e-6 * tv->tv_usec;
+}
+
+/******************************************************************************/
+static void runPhase(struct phaseStats *st, int (*phase)(void *, int),
+  void *data)
+/* Runs phase(data, fd) in a child process, whose stdout goes to /dev/null
+ * and which may write a line to fd */
+{
+  struct timespec start;
+  int fds[2], status = 1, devnull;
+  ssize_t len = 0, got;
+  pid_t pid;
+  st->ok = false;
+  st->seconds = 0;
+  st->output[0] = '\0';
+  memset(&st->usage, 0, sizeof(struct rusage));
+  if (pipe(fds)) return;
+  fflush(stdout);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pid = fork();
+  if (pid == 0)
+  {
+    close(fds[0]);
+    devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+    _exit(phase(data, fds[1]));
+  }
+  close(fds[1]);
+  if (pid < 0)
+  {
+    close(fds[0]);
+    return;
+  }
+  while (len < LONGLINE - 1 &&
+         (got = read(fds[0], st->output + len, LONGLINE - 1 - len)) > 0)
+    len += got;
+  st->output[len] = '\0';
+  close(fds[0]);
+  if (wait4(pid, &status, 0, &st->usage) != pid) return;
+  st->seconds = secondsSince(&start);
+  st->ok = (WIFEXITED(status) && !WEXITSTATUS(status)) ? true : false;
+  return;
+}
+
+/******************************************************************************/
+static void printPhase(struct benchGroup *g, const char *phase,
+  struct phaseStats *st)
+/* One JSON object, left open for further members */
+{
+  printf("{\"group\": \"%s\", \"p\": %ld, \"order\": %ld, \"phase\": \"%s\", "
+    "\"ok\": %s, \"seconds\": %.3f, \"userSeconds\": %.3f, "
+    "\"systemSeconds\": %.3f, \"maxRssKiB\": %ld, \"readBytes\": %ld, "
+    "\"writeBytes\": %ld", g->name, g->p, groupOrder(g), phase,
+    (st->ok) ? "true" : "false", st->seconds,
+    timevalSeconds(&st->usage.ru_utime), timevalSeconds(&st->usage.ru_stime),
+    st->usage.ru_maxrss, 512 * st->usage.ru_inblock,
+    512 * st->usage.ru_oublock);
+  return;
+}
+
+/******************************************************************************
+ * The phases
+ ******************************************************************************/
+
+struct phaseData
+{
+  struct benchGroup *g;
+  char stem[MAXLINE];
+  char program[MAXLINE];
+  long N;
+};
+
+/******************************************************************************/
+static int makeNontipsPhase(void *data, int fd)
+{
+  struct phaseData *pd = (struct phaseData *) data;
+  char p[MAXLINE];
+  (void) fd;
+  if (joinName(pd->program, bindir, "/", "makeNontips")) return 127;
+  snprintf(p, MAXLINE, "%ld", pd->g->p);
+  execl(pd->program, pd->program, "-O", "RLL", p, pd->stem, (char *) NULL);
+  MTX_ERROR1("cannot run %s", pd->program);
+  return 127;
+}
+
+/******************************************************************************/
+static int makeActionMatricesPhase(void *data, int fd)
+{
+  struct phaseData *pd = (struct phaseData *) data;
+  (void) fd;
+  if (joinName(pd->program, bindir, "/", "makeActionMatrices")) return 127;
+  execl(pd->program, pd->program, pd->stem, (char *) NULL);
+  MTX_ERROR1("cannot run %s", pd->program);
+  return 127;
+}
+
+/******************************************************************************/
+static int resolutionPhase(void *data, int fd)
+/* Writes the ranks of the projectives to fd */
+{
+  struct phaseData *pd = (struct phaseData *) data;
+  char line[LONGLINE];
+  long n, len = 0;
+  resol_t *resol;
+  setNumberOfThreads(threads);
+  resol = newResolWithGroupLoaded(pd->stem, pd->stem, pd->N);
+  if (!resol) return 1;
+  if (ensureThisProjectiveKnown(resol, pd->N)) return 1;
+  for (n = 0; n <= pd->N && len < LONGLINE - 24; n++)
+    len += sprintf(line + len, (n) ? ", %ld" : "%ld", rankProj(resol, n));
+  freeResolutionRecord(resol);
+  return (write(fd, line, len) == len) ? 0 : 1;
+}
+
+/****
+ * 0 on error
+ ***************************************************************************/
+static long calibratedBlockSize(struct phaseData *pd)
+/* Before the resolution phase, which inherits the block size; calibrating
+ * is not timed as part of it */
+{
+  group_t *group = fullyLoadedGroupRecord(pd->stem);
+  long bs;
+  if (!group) return 0;
+  bs = calibrateBlockSize(group, calibrationRows, pd->stem);
+  freeGroupRecord(group);
+  return bs;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int benchmarkGroup(struct benchGroup *g)
+{
+  struct phaseData pd;
+  struct phaseStats st;
+  long blockSize = AUTO_BLOCK_SIZE;
+  pd.g = g;
+  pd.N = (degree > 0) ? degree : g->degree;
+  if (joinName(pd.stem, dir, "/", g->name) ||
+      joinName(pd.program, pd.stem, "", ".reg"))
+    return 1;
+  if (fileExists(pd.program))
+  {
+    MTX_ERROR1("%s exists; use an empty directory", pd.program);
+    return 1;
+  }
+  if (writeRegularRepresentation(g, pd.stem)) return 1;
+  runPhase(&st, makeNontipsPhase, &pd);
+  printPhase(g, "makeNontips", &st);
+  printf("}\n");
+  if (!st.ok) return 1;
+  runPhase(&st, makeActionMatricesPhase, &pd);
+  printPhase(g, "makeActionMatrices", &st);
+  printf("}\n");
+  if (!st.ok) return 1;
+  if (calibrationRows && !(blockSize = calibratedBlockSize(&pd))) return 1;
+  runPhase(&st, resolutionPhase, &pd);
+  printPhase(g, "resolution", &st);
+  printf(", \"degree\": %ld, \"threads\": %ld", pd.N, threads);
+  if (blockSize != AUTO_BLOCK_SIZE) printf(", \"blockSize\": %ld", blockSize);
+  printf(", \"ranks\": [%s]}\n", st.output);
+  return (st.ok) ? 0 : 1;
+}
+
+/******************************************************************************/
+int main(int argc, const char *argv[])
+{
+  struct benchGroup *g;
+  int r = 0;
+  if (Init(argc, argv))
+  { MTX_ERROR("Error parsing command line. Try --help");
+    exit(1);
+  }
+  for (g = corpus; g->name; g++)
+    if (selected(g) && benchmarkGroup(g)) r = 1;
+  fflush(stdout);
+  Cleanup();
+  exit(r);
+}
@@ -0,0 +1,175 @@
+/* ================================================================
+   mgb.c : Make Group Bundle
+
+   Copyright (C) 2026 agent <agent@local>
+
+   This file is part of p_group_cohomology.
+
+   p_group_cohomoloy is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   p_group_cohomoloy is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with p_group_cohomoloy.  If not, see <http://www.gnu.org/licenses/>.
+   ================================================================ */
+
+#include "pgroup.h"
+#include "pgroup_decls.h"
+#include <unistd.h>
+
+MTX_DEFINE_FILE_INFO
+
+static MtxApplicationInfo_t AppInfo = {
+    "makeGroupBundle",
+
+    "Collect a group record in one binary file",
+
+    "    Reads <stem>.nontips, <stem>.gens, <stem>.lgens,\n"
+    "    <stem>.dims (if Jennings ordering used) and <stem>.bch (if present)\n"
+    "    Writes <stem>.grp, which is then used in place of these files\n"
+    "    as long as none of them has changed since\n"
+    "\n"
+    "SYNTAX\n"
+    "    makeGroupBundle [-c] <stem>\n"
+    "\n"
+    "ARGUMENTS\n"
+    "    <stem> ................. label of a prime power group\n"
+    "\n"
+    "OPTIONS\n"
+    "    -c: Check that the group record loaded from <stem>.grp\n"
+    "        agrees with the one read from the text files\n"
+    MTX_COMMON_OPTIONS_DESCRIPTION
+    "\n"
+    };
+
+static MtxApplication_t *App = NULL;
+
+/**
+ * Control variables
+ **/
+
+group_t *group = NULL;
+group_t *bundled = NULL;
+static int check = 0;
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int Init(int argc, const char *argv[])
+{
+  App = AppAlloc(&AppInfo,argc,argv);
+  if (App == NULL)
+    return 1;
+  check = AppGetOption(App, "-c");
+  if (AppGetArguments(App, 1, 1) < 0)
+    return 1;
+  return 0;
+}
+
+static void Cleanup()
+{
+    if (App != NULL)
+        AppFree(App);
+    if (group) freeGroupRecord(group);
+    if (bundled) freeGroupRecord(bundled);
+}
+
+/******************************************************************************/
+static boolean sameTrees(group_t *G, path_t *a, path_t *b)
+{
+  long i;
+  for (i = 0; i < G->nontips; i++)
+    if ((a[i].parent ? a[i].parent->index : -1) !=
+          (b[i].parent ? b[i].parent->index : -1) ||
+        (i && a[i].lastArrow != b[i].lastArrow) ||
+        a[i].depth != b[i].depth || a[i].dim != b[i].dim)
+      return false;
+  return true;
+}
+
+/******************************************************************************/
+static boolean sameMatrices(Matrix_t **a, Matrix_t **b, long num)
+{
+  long i;
+  if (!a || !b) return (a == b);
+  for (i = 0; i < num; i++)
+    if (MatCompare(a[i], b[i])) return false;
+  return true;
+}
+
+/******************************************************************************/
+static boolean sameGroupRecords(group_t *a, group_t *b)
+{
+  long i;
+  if (a->arrows != b->arrows || a->nontips != b->nontips ||
+      a->maxlength != b->maxlength || a->mintips != b->mintips ||
+      a->p != b->p || a->ordering != b->ordering)
+    return false;
+  for (i = 0; i < a->nontips; i++)
+    if (strcmp(a->nontip[i], b->nontip[i])) return false;
+  if (!sameTrees(a, a->root, b->root) || !sameTrees(a, a->lroot, b->lroot) ||
+      !sameMatrices(a->action, b->action, a->arrows) ||
+      !sameMatrices(a->laction, b->laction, a->arrows) ||
+      !sameMatrices(a->bch, b->bch, 2))
+    return false;
+  if (!a->dim || !b->dim)
+  {
+    if (a->dim != b->dim) return false;
+  }
+  else
+    for (i = 0; i <= a->dim[0]; i++)
+      if (a->dim[i] != b->dim[i]) return false;
+  for (i = 0; a->dS[i] < a->nontips; i++)
+    if (a->dS[i] != b->dS[i]) return false;
+  return (a->dS[i] == b->dS[i]);
+}
+
+/******************************************************************************/
+int main(int argc, const char *argv[])
+{
+  char name[MAXLINE];
+  if (Init(argc, argv))
+  { MTX_ERROR("Error parsing command line. Try --help");
+    exit(1);
+  }
+  /* not from an older bundle */
+  group = textLoadedGroupRecord((char *) App->ArgV[0]);
+  if (!group)
+  {
+      printf("Error loading group record\n");
+      exit(1);
+  }
+  strext(name, group->stem, ".bch");
+  if (!access(name, R_OK) && loadBasisChangeMatrices(group))
+  {
+      printf("Error loading base change matrices\n");
+      exit(1);
+  }
+  if (saveGroupBundle(group))
+  {
+      printf("Error saving group bundle\n");
+      exit(1);
+  }
+  if (check)
+  {
+    bundled = fullyLoadedGroupRecord(group->stem);
+    if (!bundled || !bundled->bundle)
+    {
+      printf("Error loading group bundle\n");
+      exit(1);
+    }
+    if (!sameGroupRecords(group, bundled))
+    {
+      printf("Group bundle does not agree with the text files\n");
+      exit(1);
+    }
+  }
+  Cleanup();
+  exit(0);
+}
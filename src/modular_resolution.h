@@ -26,6 +26,7 @@
 #if !defined(__AUFLOESUNG_INCLUDED) /* Include only once */
 #define __AUFLOESUNG_INCLUDED
 
+#include <pthread.h>
 #include "meataxe.h"
 #include "nDiag.h"
 #include "urbild_decls.h"
@@ -46,6 +47,59 @@ struct resolutionRecord
 };
 typedef struct resolutionRecord resol_t;
 
+struct preimageEngine
+{
+  group_t *group;
+  nRgs_t *nRgs; /* the urbild Groebner basis, its slices kept */
+  long n; /* preimages under d_n */
+  unsigned long calls, images;
+  unsigned long zeroImages; /* images that were zero, hence their preimages */
+  double seconds; /* spent in enginePreimages */
+};
+typedef struct preimageEngine preimEngine_t;
+
+struct pipelineJob;
+typedef struct pipelineJob pipeJob_t;
+
+struct pipelineJob
+{
+  long n; /* writes the urbild Groebner basis for d_n : P_n -> P_{n-1} */
+  FILE *fp; /* tmpFile, its header already written */
+  char *rows; /* nor rows, rowSize bytes apart, of which rowSizeIo are saved */
+  long nor;
+  size_t rowSize, rowSizeIo;
+  char ugbFile[MAXLINE];
+  char tmpFile[MAXLINE + 4]; /* renamed to ugbFile once complete */
+  char checkpoint[MAXLINE]; /* removed once ugbFile saved */
+  pipeJob_t *next;
+};
+
+struct preimageRequest;
+typedef struct preimageRequest preimReq_t;
+
+struct preimageRequest
+{
+  long n; /* preimages under d_n */
+  PTR images, preimages; /* as for innerPreimages */
+  long num;
+  preimReq_t *next;
+};
+
+struct resolutionPipeline
+{
+  resol_t *resol; /* only ever touched by the thread that owns resol */
+  long workers;
+  pthread_t *thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed; /* signalled whenever the queue changes */
+  pipeJob_t *first, *last; /* queued jobs, in order of submission */
+  long pending; /* jobs queued or running */
+  preimReq_t *requests; /* only ever touched by the owner */
+  boolean shutdown, failed;
+  char failure[MAXLINE]; /* the file a worker could not save */
+};
+typedef struct resolutionPipeline resolPipe_t;
+
 
 char *differentialFile(resol_t *resol, long n);
 /* String returned must be used at once, never reused, never freed. */
@@ -55,6 +109,18 @@ char *urbildGBFile(resol_t *resol, long n);
 /* String returned must be used at once, never reused, never freed. */
 /* Represents urbild Groebner basis for d_n : P_n -> P_{n-1} */
 
+char *checkpointFile(resol_t *resol, long n);
+/* String returned must be used at once, never reused, never freed. */
+/* Checkpoint of the Groebner basis computation for d_n */
+
+char *buchbergerLogFile(resol_t *resol, long n);
+/* String returned must be used at once, never reused, never freed. */
+/* Rounds of the Groebner basis computation for d_n */
+
+char *statisticsFile(resol_t *resol, long n);
+/* String returned must be used at once, never reused, never freed. */
+/* Counters of the Groebner basis computation for d_n, as JSON */
+
 nRgs_t *nRgsStandardSetup(resol_t *resol, long n, PTR mat);
 /* mat should be a block of length rankProj(resol, n-1) x rankProj(resol, n) */
 
@@ -69,4 +135,19 @@ nRgs_t *loadUrbildGroebnerBasis(resol_t *resol, long n);
 int innerPreimages(nRgs_t *nRgs, PTR images, long noi, group_t *group,
   PTR preimages);
 
+preimEngine_t *newPreimageEngine(resol_t *resol, long n);
+int enginePreimages(preimEngine_t *engine, PTR images, long num,
+  PTR preimages);
+void printPreimageEngineStatistics(preimEngine_t *engine, FILE *fp);
+int freePreimageEngine(preimEngine_t *engine);
+/* Single-threaded; see newPreimageEngine */
+
+resolPipe_t *newResolutionPipeline(resol_t *resol, long workers);
+int queuePreimages(resolPipe_t *pipe, long n, PTR images, long num,
+  PTR preimages);
+/* images and preimages must not be touched until finishResolutionPipeline */
+int pipelineEnsureProjective(resolPipe_t *pipe, long N);
+int finishResolutionPipeline(resolPipe_t *pipe);
+/* Frees pipe */
+
 #endif
@@ -36,6 +36,7 @@
 *   Should probably unload and destroy current sweep slice at end of Aufnahme.
 */
 
+#include <stdarg.h>
 #include "nDiag.h"
 #include "slice_decls.h"
 #include "urbild_decls.h"
@@ -69,6 +70,172 @@ static inline void updateCommonBuchStatus(ngs_t *ngs, group_t *group)
   return;
 }
 
+/* With more than one thread, the expansion products of a level are collected
+ * in batches, computed concurrently and then merged into the unreduced heap
+ * in the order of the serial expansion, so that the result is the same.
+ * A batch never spans two blocks of stored products. */
+struct expansionBatch
+{
+  ngs_t *ngs;
+  group_t *group;
+  long size, alloc;
+  PTR *w;    /* w[i] is to be multiplied... */
+  long *a;   /* ...by arrow a[i]... */
+  gV_t **gv; /* ...giving gv[i]; NULL once the unreduced heap owns it */
+};
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int allocateExpansionBatch(struct expansionBatch *eb, ngs_t *ngs,
+  group_t *group)
+{
+  register long i;
+  eb->ngs = ngs;
+  eb->group = group;
+  eb->size = 0;
+  eb->alloc = ngs->blockSize;
+  eb->w = (PTR *) malloc(eb->alloc * sizeof(PTR));
+  eb->a = (long *) malloc(eb->alloc * sizeof(long));
+  eb->gv = (gV_t **) malloc(eb->alloc * sizeof(gV_t *));
+  if (!eb->w || !eb->a || !eb->gv)
+  {
+    if (eb->w) free(eb->w);
+    if (eb->a) free(eb->a);
+    if (eb->gv) free(eb->gv);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  for (i = 0; i < eb->alloc; i++) eb->gv[i] = NULL;
+  return 0;
+}
+
+/******************************************************************************/
+static void freeExpansionBatch(struct expansionBatch *eb)
+{
+  register long i;
+  for (i = 0; i < eb->alloc; i++)
+    if (eb->gv[i]) pushGeneralVector(eb->ngs, eb->gv[i]);
+  free(eb->gv);
+  free(eb->a);
+  free(eb->w);
+  return;
+}
+
+/******************************************************************************/
+static void computeExpansionRange(void *data, long from, long to)
+{
+  struct expansionBatch *eb = (struct expansionBatch *) data;
+  ngs_t *ngs = eb->ngs;
+  group_t *group = eb->group;
+  long nor = ngs->r + ngs->s;
+  register long i;
+  register gV_t *gv;
+  for (i = from; i < to; i++)
+  {
+    gv = eb->gv[i];
+    multiplyRows(eb->w[i], group->action[eb->a[i]], gv->w, nor);
+    findLeadingMonomial(gv, ngs->r, group);
+    if (gv->coeff != FF_ZERO) makeVectorMonic(ngs, gv);
+  }
+  return;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int flushExpansionBatch(struct expansionBatch *eb, nRgs_t *nRgs)
+/* nRgs is NULL when expanding an nFgs */
+{
+  ngs_t *ngs = eb->ngs;
+  group_t *group = eb->group;
+  register long i;
+  register gV_t *gv;
+  FfSetField(group->action[0]->Field);
+  FfSetNoc(group->action[0]->Noc);
+  if (runInParallel(eb->size, computeExpansionRange, eb)) return 1;
+  ngs->stats.multiplyCalls += eb->size;
+  ngs->stats.multiplyRows += eb->size * (ngs->r + ngs->s);
+  for (i = 0; i < eb->size; i++)
+  {
+    gv = eb->gv[i];
+    if (nRgs && !gv->dim)
+    {   MTX_ERROR("Wrong multiplication!\n");
+        return 1;
+    }
+    if (gv->coeff != FF_ZERO)
+    {
+      if (insertNewUnreducedVector(ngs, gv)) return 1;
+      eb->gv[i] = NULL;
+    }
+    else if (nRgs) possiblyNewKernelGenerator(nRgs, gv->w, group);
+  }
+  eb->size = 0;
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int fillExpansionBatches(struct expansionBatch *eb, nRgs_t *nRgs)
+{
+  ngs_t *ngs = eb->ngs;
+  group_t *group = eb->group;
+  register long pat, blo, a;
+  register long dim = ngs->expDim;
+  modW_t *node;
+  path_t *ext;
+  PTR w;
+  for (blo = 0; blo < ngs->r; blo++)
+  {
+    for (pat = group->dS[dim]; pat < group->dS[dim+1]; pat++)
+    {
+      node = ngs->proot[blo] + pat;
+      if (node->status == NO_DIVISOR) continue;
+      if (node->divisor->expDim > dim) continue; /* has already been expanded */
+      ext = group->root + node->qi;
+      for (a = 0; a < group->arrows; a++)
+      {
+        if (!ext->child[a] || group->root[pat].child[a]) continue;
+        /* Loading another block would invalidate the pending w's */
+        if (eb->size == eb->alloc ||
+            (eb->size && !nodeVectorLoaded(ngs, node)))
+        { if (flushExpansionBatch(eb, nRgs)) return 1; }
+        w = nodeVector(ngs, group, node);
+        if (!w) return 1;
+        if (!eb->gv[eb->size])
+        {
+          eb->gv[eb->size] = popGeneralVector(ngs);
+          if (!eb->gv[eb->size]) return 1;
+        }
+        eb->w[eb->size] = w;
+        eb->a[eb->size++] = a;
+      }
+    }
+  }
+  return flushExpansionBatch(eb, nRgs);
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int parallelExpandThisLevel(ngs_t *ngs, nRgs_t *nRgs, group_t *group)
+/* nRgs is NULL when expanding an nFgs */
+{
+  register rV_t *rv;
+  register long dim = ngs->expDim;
+  struct expansionBatch eb;
+  int r;
+  if (allocateExpansionBatch(&eb, ngs, group)) return 1;
+  r = fillExpansionBatches(&eb, nRgs);
+  freeExpansionBatch(&eb);
+  if (r) return 1;
+  for (rv = ngs->firstReduced; rv; rv = rv->next)
+    if (rv->expDim == dim) rv->expDim++;
+  ngs->expDim++;
+  return 0;
+}
+
 /****
  * 1 on error
  ***************************************************************************/
@@ -83,6 +250,8 @@ static int nFgsExpandThisLevel(nFgs_t *nFgs, group_t *group)
   register PTR w;
   register rV_t *rv;
   register gV_t *gv;
+  if (numberOfThreads() > 1)
+    return parallelExpandThisLevel(ngs, NULL, group);
   for (blo = 0; blo < ngs->r; blo++)
   {
     for (pat = group->dS[dim]; pat < group->dS[dim+1]; pat++)
@@ -93,12 +262,13 @@ static int nFgsExpandThisLevel(nFgs_t *nFgs, group_t *group)
       ext = group->root + node->qi;
       for (a = 0; a < group->arrows; a++)
       {
-        if (!ext->child[a] || node->child[a]) continue;
+        if (!ext->child[a] || group->root[pat].child[a]) continue;
         w = nodeVector(ngs, group, node);
         if (!w) return 1;
         gv = popGeneralVector(ngs);
         if (!gv) return 1;
         if (multiply(w, group->action[a], gv->w, nor)) return 1;
+        countMultiplication(ngs, nor);
         findLeadingMonomial(gv, ngs->r, group);
         if (gv->coeff != FF_ZERO)
         {
@@ -131,6 +301,8 @@ static int nRgsExpandThisLevel(nRgs_t *nRgs, group_t *group)
   register PTR w;
   register gV_t *gv;
   register rV_t *rv;
+  if (numberOfThreads() > 1)
+    return parallelExpandThisLevel(ngs, nRgs, group);
   for (blo = 0; blo < ngs->r; blo++)
   {
     for (pat = group->dS[dim]; pat < group->dS[dim+1]; pat++)
@@ -141,12 +313,13 @@ static int nRgsExpandThisLevel(nRgs_t *nRgs, group_t *group)
       ext = group->root + node->qi;
       for (a = 0; a < group->arrows; a++)
       {
-        if (!ext->child[a] || node->child[a]) continue;
+        if (!ext->child[a] || group->root[pat].child[a]) continue;
         w = nodeVector(ngs, group, node);
         if (!w) return 1;
         gv = popGeneralVector(ngs);
         if (!gv) return 1;
         if (multiply(w, group->action[a], gv->w, nor)) return 1;
+        countMultiplication(ngs, nor);
         findLeadingMonomial(gv, ngs->r, group);
         if (!gv->dim)
         {   MTX_ERROR("Wrong multiplication!\n");
@@ -171,14 +344,6 @@ static int nRgsExpandThisLevel(nRgs_t *nRgs, group_t *group)
   return 0;
 }
 
-/******************************************************************************/
-static boolean easyCorrectRank(ngs_t *ngs, group_t *group)
-{
-  if (ngs->targetRank == RANK_UNKNOWN) return false;
-  return (ngs->targetRank + ngs->pnontips == ngs->r * group->nontips) ?
-    true : false;
-}
-
 /****
  * -1 on error
  ***************************************************************************/
@@ -200,7 +365,7 @@ static int hardCorrectRank(nFgs_t *nFgs, group_t *group)
   ngs_t *ngs = nFgs->ngs;
   if (easyCorrectRank(ngs, group)) return true;
   if (nFgs->nRgsUnfinished) return false;
-  if (ngs->unreducedHeap) return false;
+  if (ngs->numUnreduced) return false;
   return allExpansionsDone(ngs, group);
 }
 
@@ -218,6 +383,140 @@ static int nFgsBuchbergerFinished(nFgs_t *nFgs, group_t *group)
   }
 }
 
+static long maxUnfruitful = MAX_UNFRUITFUL;
+static long maxOvershoot = MAX_OVERSHOOT;
+static boolean adaptiveHeuristics = false;
+
+/******************************************************************************/
+void setMaxUnfruitful(long n)
+/* Unfruitful rounds after which nFgsBuchberger goes back to the nRgs for more
+ * generators, for each nFgs allocated from now on */
+{
+  maxUnfruitful = (n < 0) ? 0 : n;
+}
+
+/******************************************************************************/
+long maxUnfruitfulDefault(void)
+{
+  return maxUnfruitful;
+}
+
+/******************************************************************************/
+void setMaxOvershoot(long n)
+/* Unfruitful rounds of nRgsBuchberger, once the image is complete, before it
+ * turns to the kernel; for each nRgs allocated from now on */
+{
+  maxOvershoot = (n < 0) ? 0 : n;
+}
+
+/******************************************************************************/
+long maxOvershootDefault(void)
+{
+  return maxOvershoot;
+}
+
+/******************************************************************************/
+void setAdaptiveHeuristics(boolean adapt)
+/* If true, nRgsBuchberger adjusts overshoot and max_unfruitful to how the
+ * kernel grows; see adaptOvershoot and adaptMaxUnfruitful */
+{
+  adaptiveHeuristics = adapt;
+}
+
+/******************************************************************************/
+boolean adaptiveHeuristicsDefault(void)
+{
+  return adaptiveHeuristics;
+}
+
+/******************************************************************************/
+static inline void adaptMaxUnfruitful(nFgs_t *ker)
+/* Before a heady Buchberger: if the last one left to fetch more generators,
+ * and none of those came in since, it gave up too early */
+{
+  if (ker->pnonAtFetch != NONE && ker->ngs->pnontips == ker->pnonAtFetch)
+    ker->max_unfruitful++;
+  ker->pnonAtFetch = NONE;
+  return;
+}
+
+/******************************************************************************/
+static inline void adaptOvershoot(nRgs_t *nRgs, group_t *group)
+/* After a heady Buchberger that did not finish: it was started too early */
+{
+  if (nRgs->overshoot < group->maxlength) nRgs->overshoot++;
+  return;
+}
+
+/******************************************************************************/
+static void logBuchbergerRound(nRgs_t *nRgs, char *fmt, ...)
+/* Appends a line to nRgs->roundLog, if there is one. A failure to write it
+ * is not an error. */
+{
+  va_list args;
+  FILE *fp;
+  if (!nRgs->roundLog[0]) return;
+  fp = fopen(nRgs->roundLog, "a");
+  if (!fp) return;
+  va_start(args, fmt);
+  vfprintf(fp, fmt, args);
+  va_end(args);
+  fclose(fp);
+  return;
+}
+
+/******************************************************************************/
+static void writeNgsStatistics(FILE *fp, ngs_t *ngs)
+/* As a JSON object */
+{
+  register long d;
+  fprintf(fp, "{\"r\": %ld, \"s\": %ld, \"reduced\": %ld, \"heady\": %ld, "
+    "\"pnontips\": %ld, \"blockSize\": %ld,\n", ngs->r, ngs->s,
+    ngs->numReduced, ngs->numHeady, ngs->pnontips, ngs->blockSize);
+  fprintf(fp, "    \"multiplyCalls\": %lu, \"multiplyRows\": %lu, "
+    "\"productsComputed\": %lu, \"productsReused\": %lu,\n",
+    ngs->stats.multiplyCalls, ngs->stats.multiplyRows, ngs->productsComputed,
+    ngs->productsReused);
+  fprintf(fp, "    \"sliceFiles\": %lu, \"sliceBytesWritten\": %lu, "
+    "\"sliceBytesRead\": %lu, \"cacheHits\": %lu, \"cacheMisses\": %lu,\n",
+    ngs->stats.sliceFiles, ngs->stats.sliceBytesWritten,
+    ngs->stats.sliceBytesRead, ngs->cacheHits, ngs->cacheMisses);
+  fprintf(fp, "    \"promotions\": %lu, \"demotions\": %lu, \"reductions\": [",
+    ngs->stats.promotions, ngs->stats.demotions);
+  for (d = 0; d < ngs->numDims; d++)
+    fprintf(fp, (d) ? ", %lu" : "%lu", ngs->stats.reductionsOfDim[d]);
+  fprintf(fp, "],\n    \"seconds\": {\"products\": %.3f, \"aufnahme\": %.3f, "
+    "\"expansion\": %.3f}}", ngs->stats.seconds[PHASE_PRODUCTS],
+    ngs->stats.seconds[PHASE_AUFNAHME], ngs->stats.seconds[PHASE_EXPANSION]);
+  return;
+}
+
+/******************************************************************************/
+void saveBuchbergerStatistics(nRgs_t *nRgs, char *file)
+/* The counters of nRgs, its generating set and its kernel, as a JSON object.
+ * Those of a run resumed from a checkpoint only count since then. A failure
+ * to write the file is not an error. */
+{
+  nFgs_t *ker = nRgs->ker;
+  FILE *fp = fopen(file, "w");
+  if (!fp) return;
+  fprintf(fp, "{\"resumed\": %s, \"seconds\": %.3f, \"kernelSeconds\": %.3f,\n",
+    (nRgs->resumed) ? "true" : "false", nRgs->seconds, nRgs->kernelSeconds);
+  fprintf(fp, "  \"rounds\": %ld, \"fruitfulRounds\": %ld, "
+    "\"kernelRounds\": %ld, \"headyAttempts\": %ld, "
+    "\"kernelGenerators\": %lu,\n", nRgs->rounds, nRgs->fruitfulRounds,
+    nRgs->kernelRounds, nRgs->headyAttempts, nRgs->kernelGenerators);
+  fprintf(fp, "  \"overshoot\": %ld,\n  \"image\": ", nRgs->overshoot);
+  writeNgsStatistics(fp, nRgs->ngs);
+  fprintf(fp, ",\n  \"headyRounds\": %ld, \"headyFruitfulRounds\": %ld, "
+    "\"maxUnfruitful\": %ld,\n  \"kernel\": ", ker->rounds,
+    ker->fruitfulRounds, ker->max_unfruitful);
+  writeNgsStatistics(fp, ker->ngs);
+  fprintf(fp, "}\n");
+  fclose(fp);
+  return;
+}
+
 /******************************************************************************/
 static boolean appropriateToPerformHeadyBuchberger(nRgs_t *nRgs, group_t *group)
 {
@@ -269,6 +568,7 @@ static inline boolean shouldFetchMoreGenerators(nFgs_t *nFgs, group_t *group)
 int nFgsBuchberger(nFgs_t *nFgs, group_t *group)
 {
   register ngs_t *ngs = nFgs->ngs;
+  struct timespec start;
   if (nFgsAufnahme (nFgs, group)) return 1;
   initializeCommonBuchStatus(ngs);
   int allExpDone;
@@ -282,10 +582,14 @@ int nFgsBuchberger(nFgs_t *nFgs, group_t *group)
   {
     /* Can assume expDim slice precalculated; cannot assume preloaded */
     if (loadExpansionSlice(ngs, group)) return 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     if (nFgsExpandThisLevel(nFgs, group)) return 1; /* increments ngs->expDim */
+    ngs->stats.seconds[PHASE_EXPANSION] += secondsSince(&start);
     if (incrementSlice(ngs, group)) return 1;
     if (nFgsAufnahme (nFgs, group)) return 1;
     updateCommonBuchStatus(ngs, group);
+    nFgs->rounds++;
+    if (!ngs->unfruitful) nFgs->fruitfulRounds++;
     if (BuchFinished=nFgsBuchbergerFinished(nFgs, group))
     {
       if (BuchFinished==-1) return 1;
@@ -294,6 +598,7 @@ int nFgsBuchberger(nFgs_t *nFgs, group_t *group)
     }
     if (shouldFetchMoreGenerators(nFgs, group))
     {
+      nFgs->pnonAtFetch = ngs->pnontips;
       break;
     }
   }
@@ -302,6 +607,258 @@ int nFgsBuchberger(nFgs_t *nFgs, group_t *group)
   return 0;
 }
 
+/******************************************************************************
+ * A checkpoint holds the state of nRgsBuchberger between two levels: for the
+ * nRgs and for its kernel, the reduced vectors (with their expDim), the
+ * unreduced vectors (in the order they were inserted) and the products of
+ * the expansion slice. The word forest follows from the reduced vectors.
+ ******************************************************************************/
+
+#define CHECKPOINT_MAGIC 0x54504b4350524750L /* "PGRPCKPT" */
+#define CHECKPOINT_HEAD 10
+
+static long checkpointInterval = CHECKPOINT_INTERVAL;
+
+/******************************************************************************/
+void setCheckpointInterval(long seconds)
+/* Least time between two checkpoints of an nRgs that has a checkpoint file.
+ * 0 means after every level, NONE means never. */
+{
+  checkpointInterval = seconds;
+}
+
+/******************************************************************************/
+long checkpointIntervalDefault(void)
+{
+  return checkpointInterval;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeLongs(FILE *fp, long *x, long n)
+{
+  if (fwrite(x, sizeof(long), n, fp) == (size_t) n) return 0;
+  MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+  return 1;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int readLongs(FILE *fp, long *x, long n)
+{
+  if (fread(x, sizeof(long), n, fp) == (size_t) n) return 0;
+  MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+  return 1;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeGeneralVector(FILE *fp, ngs_t *ngs, gV_t *gv, long expDim)
+{
+  long nor = ngs->r + ngs->s;
+  long head[2];
+  head[0] = expDim;
+  head[1] = gv->radical;
+  if (writeLongs(fp, head, 2)) return 1;
+  if (fwrite(gv->w, FfCurrentRowSize, nor, fp) == (size_t) nor) return 0;
+  MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+  return 1;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+static gV_t *readGeneralVector(FILE *fp, ngs_t *ngs, long *expDim)
+{
+  long nor = ngs->r + ngs->s;
+  long head[2];
+  gV_t *gv;
+  if (readLongs(fp, head, 2)) return NULL;
+  gv = popGeneralVector(ngs);
+  if (!gv) return NULL;
+  if (fread(gv->w, FfCurrentRowSize, nor, fp) != (size_t) nor)
+  {
+    pushGeneralVector(ngs, gv);
+    MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+    return NULL;
+  }
+  *expDim = head[0];
+  gv->radical = (head[1]) ? true : false;
+  return gv;
+}
+
+/******************************************************************************/
+static int unreducedInsertionOrder(const void *a, const void *b)
+{
+  unsigned long s1 = (*(uV_t **) a)->seq, s2 = (*(uV_t **) b)->seq;
+  return (s1 < s2) ? -1 : (s1 > s2);
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int saveNgsState(ngs_t *ngs, FILE *fp)
+{
+  long head[5];
+  uV_t **heap;
+  rV_t *rv;
+  long i;
+  head[0] = ngs->expDim;
+  head[1] = ngs->prev_pnon;
+  head[2] = ngs->unfruitful;
+  head[3] = ngs->numReduced;
+  head[4] = ngs->numUnreduced;
+  if (writeLongs(fp, head, 5)) return 1;
+  for (rv = ngs->firstReduced; rv; rv = rv->next)
+    if (writeGeneralVector(fp, ngs, rv->gv, rv->expDim)) return 1;
+  if (ngs->numUnreduced)
+  {
+    heap = (uV_t **) malloc(ngs->numUnreduced * sizeof(uV_t *));
+    if (!heap)
+    {
+      MTX_ERROR1("%E", MTX_ERR_NOMEM);
+      return 1;
+    }
+    memcpy(heap, ngs->unreducedHeap, ngs->numUnreduced * sizeof(uV_t *));
+    qsort(heap, ngs->numUnreduced, sizeof(uV_t *), unreducedInsertionOrder);
+    for (i = 0; i < ngs->numUnreduced; i++)
+      if (writeGeneralVector(fp, ngs, heap[i]->gv, NONE)) break;
+    free(heap);
+    if (i < ngs->numUnreduced) return 1;
+  }
+  return saveExpansionProducts(ngs, fp);
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int loadNgsState(ngs_t *ngs, group_t *group, FILE *fp)
+/* ngs must be fresh from ngsAllocation */
+{
+  long head[5], expDim, i;
+  gV_t *gv;
+  rV_t *rv;
+  if (readLongs(fp, head, 5)) return 1;
+  /* so that insertReducedVector leaves expDim and the slices alone */
+  ngs->expDim = NO_BUCHBERGER_REQUIRED;
+  for (i = 0; i < head[3]; i++)
+  {
+    gv = readGeneralVector(fp, ngs, &expDim);
+    if (!gv) return 1;
+    rv = assertReducedVector(ngs, gv, group);
+    if (!rv) return 1;
+    rv->expDim = expDim;
+  }
+  ngs->expDim = head[0];
+  ngs->prev_pnon = head[1];
+  ngs->unfruitful = head[2];
+  for (i = 0; i < head[4]; i++)
+  {
+    gv = readGeneralVector(fp, ngs, &expDim);
+    if (!gv) return 1;
+    findLeadingMonomial(gv, ngs->r, group);
+    if (insertNewUnreducedVector(ngs, gv)) return 1;
+  }
+  return restoreExpansionProducts(ngs, group, fp);
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int saveNRgsCheckpoint(nRgs_t *nRgs, group_t *group)
+/* Writes the state of nRgs to nRgs->checkpoint, via a temporary file so that
+ * an interrupted write leaves the previous checkpoint intact. No dimension
+ * may be loaded, as is the case between two levels of nRgsBuchberger. */
+{
+  char tmpfile[MAXLINE + 4];
+  long head[CHECKPOINT_HEAD];
+  FILE *fp;
+  int r;
+  FfSetField(group->action[0]->Field);
+  FfSetNoc(group->nontips);
+  head[0] = CHECKPOINT_MAGIC;
+  head[1] = FfOrder;
+  head[2] = group->nontips;
+  head[3] = nRgs->ngs->r;
+  head[4] = nRgs->ngs->s;
+  head[5] = nRgs->prev_ker_pnon;
+  head[6] = nRgs->overshoot;
+  head[7] = nRgs->ker->finished;
+  head[8] = nRgs->ker->nRgsUnfinished;
+  head[9] = nRgs->ker->max_unfruitful;
+  sprintf(tmpfile, "%s.tmp", nRgs->checkpoint);
+  fp = fopen(tmpfile, "wb");
+  if (!fp)
+  {
+    MTX_ERROR2("%s: %E", tmpfile, MTX_ERR_FILEFMT);
+    return 1;
+  }
+  r = writeLongs(fp, head, CHECKPOINT_HEAD) || saveNgsState(nRgs->ngs, fp) ||
+    saveNgsState(nRgs->ker->ngs, fp);
+  if (fclose(fp)) r = 1;
+  if (!r && rename(tmpfile, nRgs->checkpoint))
+  {
+    MTX_ERROR2("%s: %E", nRgs->checkpoint, MTX_ERR_FILEFMT);
+    r = 1;
+  }
+  if (r) remove(tmpfile);
+  nRgs->checkpointTime = time(NULL);
+  return r;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int loadNRgsCheckpoint(nRgs_t *nRgs, group_t *group, char *file)
+/* nRgs must be fresh from nRgsAllocation; nRgsBuchberger then goes on where
+ * the checkpoint was taken */
+{
+  long head[CHECKPOINT_HEAD];
+  FILE *fp = fopen(file, "rb");
+  int r;
+  if (!fp)
+  {
+    MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+    return 1;
+  }
+  FfSetField(group->action[0]->Field);
+  FfSetNoc(group->nontips);
+  if (readLongs(fp, head, CHECKPOINT_HEAD))
+  {
+    fclose(fp);
+    return 1;
+  }
+  if (head[0] != CHECKPOINT_MAGIC || head[1] != FfOrder ||
+      head[2] != group->nontips || head[3] != nRgs->ngs->r ||
+      head[4] != nRgs->ngs->s)
+  {
+    fclose(fp);
+    MTX_ERROR2("%s does not fit: %E", file, MTX_ERR_INCOMPAT);
+    return 1;
+  }
+  nRgs->prev_ker_pnon = head[5];
+  nRgs->overshoot = head[6];
+  nRgs->ker->finished = (head[7]) ? true : false;
+  nRgs->ker->nRgsUnfinished = (head[8]) ? true : false;
+  nRgs->ker->max_unfruitful = head[9];
+  r = loadNgsState(nRgs->ngs, group, fp) ||
+    loadNgsState(nRgs->ker->ngs, group, fp);
+  fclose(fp);
+  if (!r) nRgs->resumed = true;
+  return r;
+}
+
+/******************************************************************************/
+static inline boolean checkpointDue(nRgs_t *nRgs)
+{
+  if (!nRgs->checkpoint[0] || checkpointInterval == NONE) return false;
+  return (time(NULL) - nRgs->checkpointTime >= checkpointInterval) ?
+    true : false;
+}
+
 /*****
  * 1 on error
  **************************************************************************/
@@ -309,16 +866,28 @@ int nRgsBuchberger(nRgs_t *nRgs, group_t *group)
 {
   register ngs_t *ngs = nRgs->ngs;
   register nFgs_t *ker = nRgs->ker;
+  struct timespec start, phase;
+  clock_gettime(CLOCK_MONOTONIC, &start);
   ker->nRgsUnfinished = true;
   if (nRgsAufnahme (nRgs, group)) return 1;
-  initializeCommonBuchStatus(ngs);
+  if (!nRgs->resumed) initializeCommonBuchStatus(ngs);
+  nRgs->checkpointTime = time(NULL);
+  logBuchbergerRound(nRgs, "%s: overshoot %ld, max_unfruitful %ld%s\n",
+    (nRgs->resumed) ? "resumed" : "started", nRgs->overshoot,
+    ker->max_unfruitful, (adaptiveHeuristics) ? ", adaptive" : "");
   int allExpDone, allExpDone2;
+  long pnon, kerPnon, rounds, fruitful;
   while (allExpDone = allExpansionsDone(ngs, group) == 0)
   {
+    if (checkpointDue(nRgs) && saveNRgsCheckpoint(nRgs, group)) return 1;
     recordCurrentSizeOfVisibleKernel(nRgs);
+    pnon = ngs->pnontips;
+    kerPnon = ker->ngs->pnontips;
     /* Can assume expDim slice precalculated; cannot assume preloaded */
     if (loadExpansionSlice(ngs, group)) return 1;
+    clock_gettime(CLOCK_MONOTONIC, &phase);
     if (nRgsExpandThisLevel(nRgs, group)) return 1; /* increments ngs->expDim */
+    ngs->stats.seconds[PHASE_EXPANSION] += secondsSince(&phase);
     if (incrementSlice(ngs, group)) return 1;
     if (nRgsAufnahme (nRgs, group)) return 1; /* Now certain no slice loaded */
     allExpDone2 = allExpansionsDone(ngs, group);
@@ -326,18 +895,46 @@ int nRgsBuchberger(nRgs_t *nRgs, group_t *group)
     if (allExpDone2==-1) return 1;
     updateCommonBuchStatus(ngs, group);
     if (nFgsAufnahme (ker, group)) return 1;
+    nRgs->rounds++;
+    if (!ngs->unfruitful) nRgs->fruitfulRounds++;
+    if (ker->ngs->pnontips < kerPnon) nRgs->kernelRounds++;
+    logBuchbergerRound(nRgs, "level %ld: pnontips %ld -> %ld, kernel %ld -> %ld, "
+      "unfruitful %ld/%ld\n", ngs->expDim - 1, pnon, ngs->pnontips, kerPnon,
+      ker->ngs->pnontips, ngs->unfruitful, nRgs->overshoot);
     if (appropriateToPerformHeadyBuchberger(nRgs, group))
     {
+      if (adaptiveHeuristics) adaptMaxUnfruitful(ker);
+      nRgs->headyAttempts++;
+      rounds = ker->rounds;
+      fruitful = ker->fruitfulRounds;
+      clock_gettime(CLOCK_MONOTONIC, &phase);
       if (nFgsBuchberger(ker, group)) return 1;
+      nRgs->kernelSeconds += secondsSince(&phase);
+      logBuchbergerRound(nRgs, "heady Buchberger: %ld rounds, %ld fruitful, "
+        "%s (max_unfruitful %ld)\n", ker->rounds - rounds,
+        ker->fruitfulRounds - fruitful,
+        (ker->finished) ? "finished" : "fetching more generators",
+        ker->max_unfruitful);
       if (ker->finished) break;
+      if (adaptiveHeuristics) adaptOvershoot(nRgs, group);
     }
   }
   if (allExpDone==-1) return 1;
   /* If targetRank known, then nFgsBuchberger guaranteed already finished. */
   /* So next line should only apply if unknown. NB nRgsUnfinished now false. */
   if (!ker->finished)
-  { if (nFgsBuchberger(ker, group)) return 1;}
+  {
+    clock_gettime(CLOCK_MONOTONIC, &phase);
+    if (nFgsBuchberger(ker, group)) return 1;
+    nRgs->kernelSeconds += secondsSince(&phase);
+  }
+  logBuchbergerRound(nRgs, "done: %ld rounds, %ld fruitful, %ld with kernel "
+    "progress; %ld heady Buchberger attempts, %ld of %ld rounds fruitful; "
+    "overshoot %ld, max_unfruitful %ld\n", nRgs->rounds, nRgs->fruitfulRounds,
+    nRgs->kernelRounds, nRgs->headyAttempts, ker->fruitfulRounds, ker->rounds,
+    nRgs->overshoot, ker->max_unfruitful);
   int r = checkRanksCorrect(nRgs); /* 0 on error */
   if (destroyExpansionSliceFile(ngs)) return 1;
+  nRgs->seconds += secondsSince(&start);
   return 1-r;
 }
@@ -28,5 +28,16 @@
 
 int nFgsBuchberger(nFgs_t *nFgs, group_t *group);
 int nRgsBuchberger(nRgs_t *nRgs, group_t *group);
+void saveBuchbergerStatistics(nRgs_t *nRgs, char *file);
+void setMaxUnfruitful(long n);
+long maxUnfruitfulDefault(void);
+void setMaxOvershoot(long n);
+long maxOvershootDefault(void);
+void setAdaptiveHeuristics(boolean adapt);
+boolean adaptiveHeuristicsDefault(void);
+void setCheckpointInterval(long seconds);
+long checkpointIntervalDefault(void);
+int saveNRgsCheckpoint(nRgs_t *nRgs, group_t *group);
+int loadNRgsCheckpoint(nRgs_t *nRgs, group_t *group, char *file);
 
 #endif
@@ -26,6 +26,7 @@
 #if !defined(__NDIAG_INCLUDED)  /* Include only once */
 #define __NDIAG_INCLUDED
 
+#include <time.h>
 #include "pcommon.h"
 #include "meataxe.h"
 #include "pgroup.h"
@@ -62,6 +63,7 @@ struct generalVector
   long block;
   int col;
   boolean radical;
+  gV_t *next; /* only used while in the pool */
 };
 
 struct unreducedVector;
@@ -71,7 +73,9 @@ struct unreducedVector
 {
   gV_t *gv;
   long index;
-  uV_t *prev, *next;
+  long pos; /* in ngs->unreducedHeap */
+  unsigned long seq; /* order of insertion, breaks ties in the heap */
+  uV_t *next; /* only used while in the pool */
 };
 
 struct moduleWord;
@@ -90,12 +94,61 @@ struct reducedVector
 
 struct moduleWord
 {
-  modW_t *parent, **child;
+  modW_t *parent; /* children are not stored, see wordForestChild */
   rV_t *divisor;
   long qi;     /* index of quotient path */
   long status;
 };
 
+#define AUTO_BLOCK_SIZE 0 /* see setBlockSize */
+
+/* Where the products of a slice are stored */
+#define SLICE_IN_FILE 0
+#define SLICE_IN_RAM 1
+
+struct storedSlice;
+typedef struct storedSlice slice_t;
+
+struct storedSlice
+{
+  long dim;
+  long nops;    /* number of products stored */
+  int where;    /* SLICE_IN_FILE or SLICE_IN_RAM */
+  PTR data;     /* SLICE_IN_RAM: nops * (r+s) rows */
+  FILE *fp;     /* SLICE_IN_FILE: open while being written or loaded */
+  char *map;    /* SLICE_IN_FILE: the file mapped, while loaded */
+  size_t mapLength;
+  slice_t *next;
+};
+
+/* Phases of the work on a generating set, timed in its statistics */
+#define PHASE_PRODUCTS 0  /* computing the products of slices */
+#define PHASE_AUFNAHME 1  /* reductions, including the products they need */
+#define PHASE_EXPANSION 2 /* multiplying reduced vectors by the arrows */
+#define NUM_PHASES 3
+
+struct ngsStatistics;
+typedef struct ngsStatistics ngsStats_t;
+
+struct ngsStatistics
+{
+  unsigned long multiplyCalls, multiplyRows;
+  unsigned long sliceFiles; /* .stp files written */
+  unsigned long sliceBytesWritten, sliceBytesRead; /* by fwrite and loadBlock */
+  unsigned long *reductionsOfDim; /* reduction steps, by dimension of the tip */
+  unsigned long promotions, demotions;
+  double seconds[NUM_PHASES];
+};
+
+struct poolChunk;
+typedef struct poolChunk poolChunk_t;
+
+struct poolChunk
+{
+  void *mem;
+  poolChunk_t *next;
+};
+
 struct newCommonGeneratingSet;
 typedef struct newCommonGeneratingSet ngs_t;
 
@@ -104,18 +157,40 @@ struct newCommonGeneratingSet
   long r, s; /* r is rank of ambient free, s rank of preimage (0 for fgs) */
   rV_t *firstReduced;
   rV_t *lastReduced;
-  uV_t *unreducedHeap;
+  rV_t **lastReducedIn; /* last of each (dim, block) run of the reduced list,
+                           at dim * r + block; NULL if the run is empty */
+  long numReduced, numHeadyReduced;
+  long numDims; /* group->maxlength + 1 */
+  long *headyOfDim; /* heady vectors, reduced or not, of each dimension */
+  long numHeady;
+  uV_t **unreducedHeap; /* binary heap, see firstUnreducedVector */
+  long numUnreduced, allocUnreduced;
+  unsigned long unreducedSeq;
   modW_t **proot;
-  gV_t *gVwaiting;
+  gV_t *freeGeneral; /* the pool: vectors not in use at the moment */
+  uV_t *freeUnreduced;
+  rV_t *freeReduced;
+  poolChunk_t *poolChunks; /* all memory of the pool, released by freeNgs */
   long pnontips; /* present guess at the number of nontips */
   long expDim;
   long targetRank;
   long dimLoaded;
-  long blockLoaded;
   long nops; /* number of products */
-  PTR thisBlock;
+  slice_t *slices; /* the stored slices, in RAM or on disk */
+  slice_t *sliceLoaded; /* the one for dimLoaded */
+  size_t sliceMemory, sliceBudget; /* bytes in RAM slices, and allowed */
+  PTR thisBlock; /* cacheSize blocks read from an unmapped .stp file */
+  long cacheSize;
+  long *cachedBlock; /* block held by each slot of thisBlock, or NONE */
+  unsigned long *cacheUsed; /* when each slot was last used */
+  unsigned long cacheClock, cacheHits, cacheMisses;
+  boolean keepSlices; /* see keepStoredSlices */
+  unsigned long productsComputed, productsReused; /* by selectNewDimension and
+                                                     incrementSlice */
+  ngsStats_t stats; /* see saveBuchbergerStatistics */
   PTR w;
   PTR theseProds;
+  PTR prodScratch; /* products of a batch, before they go to theseProds */
   long blockSize;
   char stem[MAXLINE];
   long prev_pnon, unfruitful;
@@ -127,6 +202,9 @@ struct newFlaggedGeneratingSet
   boolean nRgsUnfinished;
   ngs_t *ngs;
   long max_unfruitful;
+  long rounds, fruitfulRounds; /* of nFgsBuchberger */
+  long pnonAtFetch; /* when nFgsBuchberger last left to fetch more
+                       generators, or NONE */
 };
 
 typedef struct newFlaggedGeneratingSet nFgs_t;
@@ -136,19 +214,54 @@ struct newResentfulGeneratingSet
   nFgs_t *ker; /* ker is the hgs for the known part of kernel */
   ngs_t *ngs;
   long prev_ker_pnon, overshoot;
+  char checkpoint[MAXLINE]; /* see saveNRgsCheckpoint; empty if none */
+  time_t checkpointTime; /* of the last checkpoint */
+  boolean resumed; /* true if loaded from a checkpoint */
+  long rounds, fruitfulRounds, kernelRounds, headyAttempts;
+  unsigned long kernelGenerators; /* passed on to ker */
+  double seconds, kernelSeconds; /* in nRgsBuchberger, and in nFgsBuchberger
+                                    of ker called from there */
+  char roundLog[MAXLINE]; /* see logBuchbergerRound; empty if none */
 };
 
 typedef struct newResentfulGeneratingSet nRgs_t;
 
-// some macros related with gV_t
-#if !defined(NULL)
-#define NULL NULL
-#endif
-extern gV_t *generalVectorTemplate(long nor);
+/******************************************************************************/
+static inline modW_t *wordForestChild(ngs_t *ngs, group_t *group, modW_t *node,
+  long a)
+/* node * arrow a, or NULL. The r trees of the forest lie one after the other,
+ * each a copy of the path tree of the group */
+{
+  long k = node - ngs->proot[0];
+  path_t *c = group->root[k % group->nontips].child[a];
+  return (c) ? ngs->proot[k / group->nontips] + c->index : NULL;
+}
 
-#if !defined(popGeneralVector)
-#define popGeneralVector(ngs) ({gV_t *GV_; ((ngs)->gVwaiting) ? ({ GV_ = (ngs)->gVwaiting; (ngs)->gVwaiting = NULL; GV_;}) : ({ GV_ = generalVectorTemplate((ngs)->r + (ngs)->s); GV_;});})
-#endif
+/******************************************************************************/
+static inline double secondsSince(struct timespec *start)
+/* start as set by clock_gettime(CLOCK_MONOTONIC, start) */
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + 1e-9 * (now.tv_nsec - start->tv_nsec);
+}
 
+/******************************************************************************/
+static inline void countMultiplication(ngs_t *ngs, long rows)
+{
+  ngs->stats.multiplyCalls++;
+  ngs->stats.multiplyRows += rows;
+  return;
+}
+
+/******************************************************************************/
+static inline boolean easyCorrectRank(ngs_t *ngs, group_t *group)
+/* true if the reduced vectors are known to span everything: from then on,
+ * every unreduced vector reduces to zero */
+{
+  if (ngs->targetRank == RANK_UNKNOWN) return false;
+  return (ngs->targetRank + ngs->pnontips == ngs->r * group->nontips) ?
+    true : false;
+}
 
 #endif
@@ -40,16 +40,35 @@
 #define AUL_DEGREE 4 /* Use autolifting to determine preimages up to
                         this degree */
 
-/* #define CHAR_ODD */
-/* #define BIG_MACHINE */
+#define DEFAULT_THREADS 1 /* Threads used by the parallel code paths;
+                             see setNumberOfThreads */
 
-/* Consequences of char_odd and big_machine */
-#ifdef BIG_MACHINE
-  #define BLOCK_SIZE 2048
-#else
-  #define BLOCK_SIZE 2048
-#endif
+#define SLICE_MEMORY_BUDGET 268435456 /* Bytes of slice products a generating
+                                         set may keep in RAM before it uses
+                                         .stp files; see setSliceMemoryBudget */
+#define VECTOR_POOL_CHUNK 256 /* Vectors the pool of a generating set
+                                 allocates at once */
+#define BLOCK_CACHE_SIZE 4 /* Blocks of an unmapped .stp file kept in RAM;
+                              see setBlockCacheSize */
+#define ACTION_CACHE_MEMORY 67108864 /* Bytes of right action matrices a group
+                                        may cache; see setActionCacheMemory */
+#define CHECKPOINT_INTERVAL 3600 /* Seconds between checkpoints of a
+                                    differential being computed; see
+                                    setCheckpointInterval */
+
+#define BLOCK_BYTES 1048576 /* Bytes a block of slice products aims at when
+                               its size is chosen automatically; see
+                               setBlockSize */
+#define MIN_BLOCK_SIZE 64 /* Bounds of an automatic or calibrated block size */
+#define MAX_BLOCK_SIZE 65536
+#define BLOCK_MEMORY_SHARE 64 /* The blocks of a generating set take at most
+                                 this fraction of the physical memory */
+#define CALIBRATION_BYTES 33554432 /* Bytes of products calibrateBlockSize
+                                      writes and reads per block size */
+
+/* #define CHAR_ODD */
 
+/* Defaults; see setMaxUnfruitful and setMaxOvershoot */
 #ifdef CHAR_ODD
   #define MAX_UNFRUITFUL 1
   #define MAX_OVERSHOOT 5
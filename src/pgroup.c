@@ -20,9 +20,21 @@
     along with p_group_cohomoloy.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 #include "pgroup.h"
 #include "pgroup_decls.h"
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GF2_X86_KERNELS
+#endif
 
 MTX_DEFINE_FILE_INFO
 
@@ -59,6 +71,91 @@ void strext(char *dest, char *stem, char *ext)
   return;
 }
 
+/******************************************************************************/
+static long numThreads = DEFAULT_THREADS;
+
+/******************************************************************************/
+void setNumberOfThreads(long n)
+{
+  numThreads = (n < 1) ? 1 : n;
+  return;
+}
+
+/******************************************************************************/
+long numberOfThreads(void)
+{
+  return numThreads;
+}
+
+struct parallelRange
+{
+  void (*job)(void *data, long from, long to);
+  void *data;
+  long from, to;
+  boolean spawned;
+};
+
+/******************************************************************************/
+static void *parallelRangeRunner(void *arg)
+{
+  struct parallelRange *range = (struct parallelRange *) arg;
+  range->job(range->data, range->from, range->to);
+  return NULL;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int runInParallel(long n, void (*job)(void *data, long from, long to),
+  void *data)
+/* Splits 0..n-1 into at most numberOfThreads() contiguous ranges and calls
+ * job(data, from, to) once per range, each range in a thread of its own.
+ * The first range runs in the calling thread. Returns after all ranges
+ * are done. Since the MeatAxe field parameters are global, job must not
+ * call FfSetField or FfSetNoc. */
+{
+  long threads = (numThreads < n) ? numThreads : n;
+  long chunk, t;
+  pthread_t *thread;
+  struct parallelRange *range;
+  if (threads <= 1)
+  {
+    if (n > 0) job(data, 0, n);
+    return 0;
+  }
+  thread = (pthread_t *) malloc(threads * sizeof(pthread_t));
+  range = (struct parallelRange *) malloc(threads * sizeof(struct parallelRange));
+  if (!thread || !range)
+  {
+    if (thread) free(thread);
+    if (range) free(range);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  chunk = (n + threads - 1) / threads;
+  for (t = 0; t < threads; t++)
+  {
+    range[t].job = job;
+    range[t].data = data;
+    range[t].from = t * chunk;
+    range[t].to = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+  }
+  for (t = 1; t < threads; t++)
+  {
+    range[t].spawned =
+      pthread_create(thread + t, NULL, parallelRangeRunner, range + t) ?
+      false : true;
+    /* Could not spawn: do this range ourselves */
+    if (!range[t].spawned) parallelRangeRunner(range + t);
+  }
+  parallelRangeRunner(range);
+  for (t = 1; t < threads; t++)
+    if (range[t].spawned) pthread_join(thread[t], NULL);
+  free(thread);
+  free(range);
+  return 0;
+}
+
 /*****************************************************************************/
 inline boolean fileExists(const char *name)
 {
@@ -106,6 +203,11 @@ group_t *newGroupRecord (void)
   group->bch = NULL;
   group->dim = NULL;
   group->dS = NULL;
+  group->rcache = NULL;
+  group->bundle = NULL;
+  group->bundleLength = 0;
+  group->bundleMapped = false;
+  group->composedZero = group->composedMonomial = group->composedDense = 0;
   return group;
 }
 
@@ -617,6 +719,38 @@ inline void freeRoot(path_t *root)
   return;
 }
 
+/****
+ * NULL on error
+ ***************************************************************************/
+static Matrix_t **matrixListAt(group_t *group, char *data, long num)
+/* Like allocateMatrixList, but the matrices are the num consecutive blocks
+ * of nontips rows at data, which must remain valid as long as they do */
+{
+  Matrix_t *mat, **action;
+  long i;
+  mat = (Matrix_t *) malloc(num * sizeof(Matrix_t));
+  action = (Matrix_t **) malloc(num * sizeof(Matrix_t *));
+  if (!mat || !action)
+  {
+    if (mat) free(mat);
+    if (action) free(action);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  for (i = 0; i < num; i++)
+  {
+    action[i] = mat + i;
+    action[i]->Field = FfOrder;
+    action[i]->Nor = group->nontips;
+    action[i]->Noc = group->nontips;
+    action[i]->Data = (PTR) (data + i * group->nontips * FfCurrentRowSize);
+    action[i]->PivotTable = NULL;
+    action[i]->RowSize = FfCurrentRowSize;
+    action[i]->Magic = MAT_MAGIC;
+  }
+  return action;
+}
+
 /****
  * NULL on error
  ***************************************************************************/
@@ -625,7 +759,6 @@ Matrix_t **loadMatrixList(group_t *group, char *name, long num)
   Matrix_t *bigmat;
   Matrix_t **action;
   long nontips = group->nontips;
-  long i;
   bigmat = MatLoad(name); /* sets FfOrder, FfNoc to required values */
   if (!bigmat) return NULL;
   if (bigmat->Noc != nontips)
@@ -643,26 +776,14 @@ Matrix_t **loadMatrixList(group_t *group, char *name, long num)
       MTX_ERROR1("matrices over wrong characteristic field: %E", MTX_ERR_INCOMPAT);
       return NULL;
     }
-  action = (Matrix_t **) malloc (num * sizeof(void*));
+  /* The matrices stay where MatLoad put them, as in allocateMatrixList */
+  action = matrixListAt(group, (char *) bigmat->Data, num);
   if (!action)
   {
       MatFree(bigmat);
-      MTX_ERROR1("%E", MTX_ERR_NOMEM);
       return NULL;
   }
-  Matrix_t *tmp;
-  size_t chunksize = FfCurrentRowSize*nontips;
-  for (i = 0; i < num; i++)
-  {
-      tmp = MatAlloc(bigmat->Field, nontips, bigmat->Noc);
-      if (!tmp)
-      { MatFree(bigmat);
-        MTX_ERROR1("%E", MTX_ERR_NOMEM);
-        return NULL;
-      }
-      memcpy(tmp->Data, MatGetPtr(bigmat, i*nontips), chunksize);
-      action[i] = tmp;
-  }
+  bigmat->Data = NULL; /* now owned by action, see freeMatrixList */
   MatFree(bigmat);
   return action;
 }
@@ -697,6 +818,7 @@ inline int loadLeftActionMatrices(group_t *group)
 int loadBasisChangeMatrices(group_t *group)
 {
   char name[MAXLINE];
+  if (group->bundle && group->bch) return 0; /* came with the bundle */
   strext(name, group->stem, ".bch");
   group->bch = loadMatrixList(group, name, 2);
   if (!group->bch) return 1;
@@ -842,6 +964,284 @@ inline void freeActionMatrices(Matrix_t **mat)
   free(mat);
 }
 
+/******************************************************************************
+ * GF(2) kernels: result += the rows idx[0], ..., idx[n-1] of matrix, each row
+ * being size bytes, from byte c on. The result is kept in registers while all
+ * n rows are added, one chunk of columns after another. The AVX2 and AVX-512
+ * versions are used if the CPU has them; see chooseGF2Kernel.
+ ******************************************************************************/
+
+static void gf2AddRowsGeneric(BYTE *result, const BYTE *matrix,
+  const long *idx, long n, size_t size, size_t c)
+{
+  register long t;
+  for (; c + 4 * sizeof(long) <= size; c += 4 * sizeof(long))
+  {
+    register long *l = (long *) (result + c);
+    register long a0 = l[0], a1 = l[1], a2 = l[2], a3 = l[3];
+    for (t = 0; t < n; t++)
+    {
+      register const long *x = (const long *) (matrix + idx[t] * size + c);
+      a0 ^= x[0]; a1 ^= x[1]; a2 ^= x[2]; a3 ^= x[3];
+    }
+    l[0] = a0; l[1] = a1; l[2] = a2; l[3] = a3;
+  }
+  for (; c < size; c += sizeof(long))
+  {
+    register long a = *(long *) (result + c);
+    for (t = 0; t < n; t++)
+      a ^= *(const long *) (matrix + idx[t] * size + c);
+    *(long *) (result + c) = a;
+  }
+}
+
+#ifdef GF2_X86_KERNELS
+__attribute__((target("avx2")))
+static void gf2AddRowsAvx2(BYTE *result, const BYTE *matrix,
+  const long *idx, long n, size_t size, size_t c)
+{
+  register long t;
+  for (; c + 128 <= size; c += 128)
+  {
+    __m256i *r = (__m256i *) (result + c);
+    __m256i a0 = _mm256_loadu_si256(r), a1 = _mm256_loadu_si256(r + 1);
+    __m256i a2 = _mm256_loadu_si256(r + 2), a3 = _mm256_loadu_si256(r + 3);
+    for (t = 0; t < n; t++)
+    {
+      const __m256i *x = (const __m256i *) (matrix + idx[t] * size + c);
+      a0 = _mm256_xor_si256(a0, _mm256_loadu_si256(x));
+      a1 = _mm256_xor_si256(a1, _mm256_loadu_si256(x + 1));
+      a2 = _mm256_xor_si256(a2, _mm256_loadu_si256(x + 2));
+      a3 = _mm256_xor_si256(a3, _mm256_loadu_si256(x + 3));
+    }
+    _mm256_storeu_si256(r, a0); _mm256_storeu_si256(r + 1, a1);
+    _mm256_storeu_si256(r + 2, a2); _mm256_storeu_si256(r + 3, a3);
+  }
+  for (; c + 32 <= size; c += 32)
+  {
+    __m256i a = _mm256_loadu_si256((__m256i *) (result + c));
+    for (t = 0; t < n; t++)
+      a = _mm256_xor_si256(a,
+        _mm256_loadu_si256((const __m256i *) (matrix + idx[t] * size + c)));
+    _mm256_storeu_si256((__m256i *) (result + c), a);
+  }
+  if (c < size)
+    gf2AddRowsGeneric(result, matrix, idx, n, size, c);
+}
+
+/******************************************************************************/
+__attribute__((target("avx512f")))
+static void gf2AddRowsAvx512(BYTE *result, const BYTE *matrix,
+  const long *idx, long n, size_t size, size_t c)
+{
+  register long t;
+  for (; c + 256 <= size; c += 256)
+  {
+    BYTE *r = result + c;
+    __m512i a0 = _mm512_loadu_si512(r), a1 = _mm512_loadu_si512(r + 64);
+    __m512i a2 = _mm512_loadu_si512(r + 128), a3 = _mm512_loadu_si512(r + 192);
+    for (t = 0; t < n; t++)
+    {
+      const BYTE *x = matrix + idx[t] * size + c;
+      a0 = _mm512_xor_si512(a0, _mm512_loadu_si512(x));
+      a1 = _mm512_xor_si512(a1, _mm512_loadu_si512(x + 64));
+      a2 = _mm512_xor_si512(a2, _mm512_loadu_si512(x + 128));
+      a3 = _mm512_xor_si512(a3, _mm512_loadu_si512(x + 192));
+    }
+    _mm512_storeu_si512(r, a0); _mm512_storeu_si512(r + 64, a1);
+    _mm512_storeu_si512(r + 128, a2); _mm512_storeu_si512(r + 192, a3);
+  }
+  for (; c + 64 <= size; c += 64)
+  {
+    __m512i a = _mm512_loadu_si512(result + c);
+    for (t = 0; t < n; t++)
+      a = _mm512_xor_si512(a, _mm512_loadu_si512(matrix + idx[t] * size + c));
+    _mm512_storeu_si512(result + c, a);
+  }
+  if (c < size)
+    gf2AddRowsAvx2(result, matrix, idx, n, size, c);
+}
+#endif
+
+static void (*gf2AddRowsFrom)(BYTE *result, const BYTE *matrix,
+  const long *idx, long n, size_t size, size_t c) = gf2AddRowsGeneric;
+static pthread_once_t gf2KernelChosen = PTHREAD_ONCE_INIT;
+
+/******************************************************************************/
+static void chooseGF2Kernel(void)
+{
+#ifdef GF2_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) gf2AddRowsFrom = gf2AddRowsAvx512;
+  else if (__builtin_cpu_supports("avx2")) gf2AddRowsFrom = gf2AddRowsAvx2;
+#endif
+}
+
+#define gf2AddRows(result, matrix, idx, n, size) \
+  gf2AddRowsFrom(result, matrix, idx, n, size, 0)
+
+#define GF2_BATCH 256 /* rows added in one call of gf2AddRows */
+
+/******************************************************************************
+ * Method of the four Russians over GF(2): the sums of all subsets of eight
+ * consecutive rows of matrix are tabulated, GF2_TABLES tables at a time, so
+ * that one table row per byte of a vector replaces up to eight row additions.
+ * Worthwhile once a matrix is applied to GF2_FOUR_RUSSIANS_MIN vectors or more.
+ ******************************************************************************/
+
+#define GF2_TABLES 8
+#define GF2_FOUR_RUSSIANS_MIN 64
+
+static void gf2BuildTable(BYTE *table, const BYTE *matrix, long first,
+  long nor, size_t size)
+/* table: 256 rows; row b is the sum of those rows first + t of matrix,
+ * t < 8 and first + t < nor, for which bit 0x80 >> t of b is set */
+{
+  long b;
+  memset(table, 0, size);
+  for (b = 1; b < 256; b++)
+  {
+    long row = first + 7 - __builtin_ctzl(b);
+    long *dest = (long *) (table + b * size);
+    const long *prev = (const long *) (table + (b & (b - 1)) * size);
+    size_t c;
+    if (row < nor)
+    {
+      const long *x = (const long *) (matrix + row * size);
+      for (c = 0; c < size / sizeof(long); c++) dest[c] = prev[c] ^ x[c];
+    }
+    else memcpy(dest, prev, size);
+  }
+}
+
+/******************************************************************************/
+static void gf2AddMapRows(const BYTE *rows, long num, const BYTE *matrix,
+  long nor, BYTE *tables, BYTE *results)
+/* results[k] += rows[k] * matrix for k < num, consecutive rows */
+{
+  size_t size = FfCurrentRowSize;
+  long bytes = (nor + 7) / 8;
+  long g0, g, k, n;
+  long idx[GF2_TABLES];
+  for (g0 = 0; g0 < bytes; g0 += GF2_TABLES)
+  {
+    long ng = (bytes - g0 < GF2_TABLES) ? bytes - g0 : GF2_TABLES;
+    for (g = 0; g < ng; g++)
+      gf2BuildTable(tables + g * 256 * size, matrix, 8 * (g0 + g), nor, size);
+    for (k = 0; k < num; k++)
+    {
+      const BYTE *r = rows + k * size + g0;
+      for (n = 0, g = 0; g < ng; g++)
+        if (r[g]) idx[n++] = g * 256 + r[g];
+      if (n) gf2AddRows(results + k * size, tables, idx, n, size);
+    }
+  }
+}
+
+/******************************************************************************
+ * Small odd primes: each packed byte of a row is widened into one unsigned
+ * long long, its MPB digits in lanes of SPREAD_BITS bits. Rows are then added
+ * up lane-wise without reduction, which is done only when a lane could
+ * overflow, and once at the end.
+ ******************************************************************************/
+
+typedef unsigned long long spread_t;
+
+struct spreadTable
+{
+  int p, mpb, bits;
+  spread_t lane[256]; /* packed byte -> its digits, one per lane */
+  long weight[8];     /* digit at position pos counts weight[pos] in a byte */
+  pthread_once_t once;
+};
+
+static struct spreadTable spread3 = {3, 5, 12, {0}, {0}, PTHREAD_ONCE_INIT};
+static struct spreadTable spread5 = {5, 3, 21, {0}, {0}, PTHREAD_ONCE_INIT};
+
+/******************************************************************************/
+static void makeSpreadTable(struct spreadTable *st)
+/* The field of st must be the current one */
+{
+  int b, pos;
+  for (pos = 0; pos < st->mpb; pos++)
+    st->weight[pos] = mtx_tinsert[pos][1];
+  for (b = 0; b < 256; b++)
+  {
+    st->lane[b] = 0;
+    for (pos = 0; pos < st->mpb; pos++)
+      st->lane[b] |= ((spread_t) mtx_textract[pos][b]) << (st->bits * pos);
+  }
+}
+
+static void makeSpreadTable3(void) { makeSpreadTable(&spread3); }
+static void makeSpreadTable5(void) { makeSpreadTable(&spread5); }
+
+/******************************************************************************/
+static inline void reduceLanes(spread_t *acc, long bytes, const int p,
+  const int mpb, const int bits)
+{
+  const spread_t mask = (((spread_t) 1) << bits) - 1;
+  long k;
+  int pos;
+  for (k = 0; k < bytes; k++)
+  {
+    spread_t a = acc[k], red = 0;
+    for (pos = 0; pos < mpb; pos++)
+      red |= (((a >> (bits * pos)) & mask) % p) << (bits * pos);
+    acc[k] = red;
+  }
+}
+
+/******************************************************************************/
+static inline __attribute__((always_inline))
+void addMapRowSmallPrime(const struct spreadTable *st, PTR row, PTR matrix,
+  int nor, PTR result, const int p, const int mpb, const int bits)
+/* FfAddMapRow for FfOrder == p; p, mpb and bits are compile time constants */
+{
+  const spread_t mask = (((spread_t) 1) << bits) - 1;
+  /* rows that may be added before a lane has to be reduced */
+  const long limit = ((((spread_t) 1) << bits) - p) / ((p - 1) * (p - 1));
+  const long bytes = FfCurrentRowSizeIo;
+  const spread_t *lane = st->lane;
+  spread_t acc[bytes];
+  BYTE *brow = (BYTE *) row, *m = (BYTE *) matrix, *r = (BYTE *) result;
+  long i, k, added = 0;
+  int pos;
+  for (k = 0; k < bytes; k++) acc[k] = lane[r[k]];
+  for (i = 0; i < nor; brow++)
+  {
+    spread_t digits = lane[*brow];
+    if (digits == 0)
+    {
+      i += mpb;
+      m += mpb * FfCurrentRowSize;
+      continue;
+    }
+    for (pos = 0; pos < mpb && i < nor; pos++, i++, m += FfCurrentRowSize)
+    {
+      register spread_t f = (digits >> (bits * pos)) & mask;
+      if (f == 0) continue;
+      if (f == 1)
+        for (k = 0; k < bytes; k++) acc[k] += lane[m[k]];
+      else
+        for (k = 0; k < bytes; k++) acc[k] += f * lane[m[k]];
+      if (++added == limit)
+      {
+        reduceLanes(acc, bytes, p, mpb, bits);
+        added = 0;
+      }
+    }
+  }
+  for (k = 0; k < bytes; k++)
+  {
+    spread_t a = acc[k];
+    long b = 0;
+    for (pos = 0; pos < mpb; pos++)
+      b += (long) (((a >> (bits * pos)) & mask) % p) * st->weight[pos];
+    r[k] = (BYTE) b;
+  }
+}
+
 /******************************************************************************
  * The following is basically a copy of FfMapRow, deleting some assembly code.
  * Only difference: The @em result is not initialized to zero.
@@ -859,35 +1259,37 @@ void FfAddMapRow(PTR row, PTR matrix, int nor, PTR result)
     register int i;
     register FEL f;
     BYTE *m = (BYTE *) matrix;
-    register long *l = (long *)result;
 
     if (FfOrder == 2)       /* GF(2) is a special case */
     {
-        register long *x1 = (long *) matrix;
         register BYTE *r = (BYTE *) row;
-
-        for (i = nor; i > 0; ++r)
+        long idx[GF2_BATCH];
+        register long n = 0;
+        pthread_once(&gf2KernelChosen, chooseGF2Kernel);
+        for (i = 0; i < nor; i += 8, ++r)
         {
-            register BYTE mask;
-            if (*r == 0)   /* Skip eight rows */
+            register BYTE b = *r;
+            register int t;
+            if (b == 0) continue;   /* Skip eight rows */
+            for (t = 0; b != 0 && i + t < nor; ++t, b <<= 1)
+                if (b & 0x80) idx[n++] = i + t;
+            if (n > GF2_BATCH - 8)
             {
-            i -= 8;
-            x1 += 8 * LPR;
-            continue;
-            }
-            for (mask = 0x80; mask != 0 && i > 0; mask >>= 1, --i)
-            {
-                if ((mask & *r) == 0)
-                {
-                    x1 += LPR;  /* Skip that row */
-                    continue;
-                }
-                register long *x2 = (long *)result;
-                register int k;
-                for (k = LPR; k; --k)
-                    *x2++ ^= *x1++;
+                gf2AddRows((BYTE *) result, m, idx, n, LPR * sizeof(long));
+                n = 0;
             }
         }
+        if (n) gf2AddRows((BYTE *) result, m, idx, n, LPR * sizeof(long));
+    }
+    else if (FfOrder == 3 && MPB == 5)
+    {
+        pthread_once(&spread3.once, makeSpreadTable3);
+        addMapRowSmallPrime(&spread3, row, matrix, nor, result, 3, 5, 12);
+    }
+    else if (FfOrder == 5 && MPB == 3)
+    {
+        pthread_once(&spread5.once, makeSpreadTable5);
+        addMapRowSmallPrime(&spread5, row, matrix, nor, result, 5, 3, 21);
     }
     else                /* Any other field */
     {
@@ -957,9 +1359,12 @@ static inline long modifiedMinlong(long n1, long n2)
   return minlong(n1, n2);
 }
 
+static void releaseGroupBundle(group_t *group);
+
 /******************************************************************************/
 void freeGroupRecord (group_t *group)
 {
+  if (group->bundle) releaseGroupBundle(group);
   if (group->stem) free(group->stem);
   if (group->nontip) freeNonTips (group->nontip);
   if (group->root) freeRoot (group->root);
@@ -969,6 +1374,7 @@ void freeGroupRecord (group_t *group)
   if (group->bch) freeActionMatrices (group->bch);
   if (group->dim) free(group->dim);
   if (group->dS) free(group->dS);
+  if (group->rcache) freeActionCache(group);
   free (group);
   return;
 }
@@ -1063,6 +1469,236 @@ void innerRightActionMatrix(group_t *group, PTR vec, PTR dest)
   return;
 }
 
+static size_t actionCacheMemory = ACTION_CACHE_MEMORY;
+
+/******************************************************************************/
+void setActionCacheMemory(size_t bytes)
+/* Bytes of right action matrices that each group may cache from now on.
+ * 0 switches the cache off. */
+{
+  actionCacheMemory = bytes;
+}
+
+/******************************************************************************/
+size_t actionCacheMemoryDefault(void)
+{
+  return actionCacheMemory;
+}
+
+/******************************************************************************/
+static inline size_t actionCacheEntrySize(group_t *group)
+{
+  return sizeof(actionCacheEntry_t) + (group->nontips + 1) * FfCurrentRowSize;
+}
+
+/******************************************************************************/
+static inline unsigned long hashOfRow(PTR vec)
+/* FNV-1a */
+{
+  register unsigned long h = 14695981039346656037UL;
+  register BYTE *b = (BYTE *) vec;
+  register long k;
+  for (k = FfCurrentRowSizeIo; k > 0; k--, b++)
+  {
+    h ^= *b;
+    h *= 1099511628211UL;
+  }
+  return h;
+}
+
+/******************************************************************************/
+void freeActionCache(group_t *group)
+{
+  actionCache_t *cache = group->rcache;
+  actionCacheEntry_t *e, *older;
+  if (!cache) return;
+  for (e = cache->newest; e; e = older)
+  {
+    older = e->older;
+    free(e);
+  }
+  pthread_mutex_destroy(&cache->lock);
+  pthread_cond_destroy(&cache->built);
+  free(cache->bucket);
+  free(cache);
+  group->rcache = NULL;
+}
+
+/******************************************************************************/
+static actionCache_t *newActionCache(group_t *group, size_t cap)
+/* NULL if out of memory; the caller may do without a cache */
+{
+  actionCache_t *cache = (actionCache_t *) malloc(sizeof(actionCache_t));
+  size_t entries = cap / actionCacheEntrySize(group);
+  if (!cache) return NULL;
+  cache->numBuckets = 16;
+  while (cache->numBuckets < entries && cache->numBuckets < (1UL << 20))
+    cache->numBuckets <<= 1;
+  cache->bucket = (actionCacheEntry_t **)
+    calloc(cache->numBuckets, sizeof(actionCacheEntry_t *));
+  if (!cache->bucket)
+  {
+    free(cache);
+    return NULL;
+  }
+  cache->noc = FfNoc;
+  cache->memory = 0;
+  cache->cap = cap;
+  cache->newest = cache->oldest = NULL;
+  cache->hits = cache->misses = 0;
+  pthread_mutex_init(&cache->lock, NULL);
+  pthread_cond_init(&cache->built, NULL);
+  return cache;
+}
+
+/******************************************************************************/
+static void dropAction(actionCache_t *cache, actionCacheEntry_t *e,
+  size_t entrySize)
+{
+  actionCacheEntry_t **link;
+  for (link = cache->bucket + (e->hash & (cache->numBuckets - 1));
+       *link != e; link = &((*link)->nextInBucket));
+  *link = e->nextInBucket;
+  if (e->newer) e->newer->older = e->older;
+  else cache->newest = e->older;
+  if (e->older) e->older->newer = e->newer;
+  else cache->oldest = e->newer;
+  cache->memory -= entrySize;
+  free(e);
+}
+
+/******************************************************************************/
+static actionCacheEntry_t *newActionEntry(actionCache_t *cache, group_t *group,
+  PTR vec, unsigned long h)
+/* Caller holds cache->lock. Least recently used entries make room, unless
+ * they are pinned. The new entry is pinned and not ready yet.
+ * NULL if there is no room or memory. */
+{
+  size_t entrySize = actionCacheEntrySize(group);
+  actionCacheEntry_t *e, *victim, *newer, **link;
+  for (victim = cache->oldest;
+       victim && cache->memory + entrySize > cache->cap; victim = newer)
+  {
+    newer = victim->newer;
+    if (!victim->users) dropAction(cache, victim, entrySize);
+  }
+  if (cache->memory + entrySize > cache->cap) return NULL;
+  e = (actionCacheEntry_t *) malloc(entrySize);
+  if (!e) return NULL;
+  e->key = (PTR) (e + 1);
+  memcpy(e->key, vec, FfCurrentRowSize);
+  e->hash = h;
+  e->users = 1;
+  e->ready = false;
+  link = cache->bucket + (h & (cache->numBuckets - 1));
+  e->nextInBucket = *link;
+  *link = e;
+  e->newer = NULL;
+  e->older = cache->newest;
+  if (cache->newest) cache->newest->newer = e;
+  else cache->oldest = e;
+  cache->newest = e;
+  cache->memory += entrySize;
+  return e;
+}
+
+/******************************************************************************/
+static actionCache_t *actionCacheOf(group_t *group)
+/* The cache of group, made to fit the present FfNoc and action cache
+ * memory; NULL if there is none. Must not run concurrently with lookups. */
+{
+  actionCache_t *cache = group->rcache;
+  if (cache && (cache->noc != FfNoc || cache->cap != actionCacheMemory))
+  {
+    freeActionCache(group);
+    cache = NULL;
+  }
+  if (!cache && actionCacheEntrySize(group) <= actionCacheMemory)
+    cache = group->rcache = newActionCache(group, actionCacheMemory);
+  return cache;
+}
+
+/******************************************************************************/
+static PTR pinnedRightActionMatrix(group_t *group, PTR vec, PTR scratch,
+  actionCacheEntry_t **pin)
+/* The right action matrix of vec. If it is in the cache, *pin is its entry,
+ * which is not evicted before unpinAction. Else *pin is NULL, and the matrix
+ * has been computed at scratch. A matrix that another thread is computing
+ * is waited for. Thread safe, once actionCacheOf has set up the cache. */
+{
+  actionCache_t *cache = group->rcache;
+  actionCacheEntry_t *e;
+  unsigned long h;
+  *pin = NULL;
+  if (!cache)
+  {
+    innerRightActionMatrix(group, vec, scratch);
+    return scratch;
+  }
+  h = hashOfRow(vec);
+  pthread_mutex_lock(&cache->lock);
+  for (e = cache->bucket[h & (cache->numBuckets - 1)]; e; e = e->nextInBucket)
+    if (e->hash == h && !memcmp(e->key, vec, FfCurrentRowSizeIo)) break;
+  if (e)
+  {
+    cache->hits++;
+    if (e != cache->newest)
+    { /* move to the front of the list */
+      e->newer->older = e->older;
+      if (e->older) e->older->newer = e->newer;
+      else cache->oldest = e->newer;
+      e->older = cache->newest;
+      e->newer = NULL;
+      cache->newest->newer = e;
+      cache->newest = e;
+    }
+    e->users++;
+    while (!e->ready) pthread_cond_wait(&cache->built, &cache->lock);
+    pthread_mutex_unlock(&cache->lock);
+    *pin = e;
+    return FfGetPtr(e->key, 1);
+  }
+  cache->misses++;
+  e = newActionEntry(cache, group, vec, h);
+  pthread_mutex_unlock(&cache->lock);
+  if (!e)
+  {
+    innerRightActionMatrix(group, vec, scratch);
+    return scratch;
+  }
+  innerRightActionMatrix(group, vec, FfGetPtr(e->key, 1));
+  pthread_mutex_lock(&cache->lock);
+  e->ready = true;
+  pthread_cond_broadcast(&cache->built);
+  pthread_mutex_unlock(&cache->lock);
+  *pin = e;
+  return FfGetPtr(e->key, 1);
+}
+
+/******************************************************************************/
+static void unpinAction(group_t *group, actionCacheEntry_t *pin)
+{
+  if (!pin) return;
+  pthread_mutex_lock(&group->rcache->lock);
+  pin->users--;
+  pthread_mutex_unlock(&group->rcache->lock);
+}
+
+/******************************************************************************/
+PTR cachedRightActionMatrix(group_t *group, PTR vec, PTR scratch)
+/* The right action matrix of vec, as innerRightActionMatrix computes it.
+ * It is taken from or entered into the cache of group if possible, and else
+ * computed at scratch (nontips rows). The result must not be altered, and is
+ * only valid until the next call for this group. */
+{
+  actionCacheEntry_t *pin;
+  PTR mat;
+  actionCacheOf(group);
+  mat = pinnedRightActionMatrix(group, vec, scratch, &pin);
+  unpinAction(group, pin);
+  return mat;
+}
+
 /******************************************************************************/
 void innerLeftActionMatrix(group_t *group, PTR vec, PTR dest)
 {
@@ -1092,6 +1728,188 @@ inline Matrix_t *leftActionMatrix(group_t *group, PTR vec)
   return mat;
 }
 
+/******************************************************************************/
+static int rowSupport(PTR vec, long *col, FEL *coeff)
+/* 0 if vec is zero, 1 if it has exactly one nonzero entry, which is then
+ * coeff at col, and 2 otherwise */
+{
+  register BYTE *b = (BYTE *) vec;
+  long bytes = FfCurrentRowSizeIo, first, k;
+  int pos, found = 0;
+  for (first = 0; first < bytes && b[first] == 0; first++);
+  if (first == bytes) return 0;
+  for (k = first + 1; k < bytes; k++)
+    if (b[k]) return 2;
+  for (pos = 0; pos < MPB; pos++)
+  {
+    FEL f = mtx_textract[pos][b[first]];
+    if (f == FF_ZERO) continue;
+    if (found++) return 2;
+    *col = first * MPB + pos;
+    *coeff = f;
+  }
+  return 1;
+}
+
+/******************************************************************************/
+static BYTE *gf2FourRussiansTables(long nor)
+/* Space for the tables of gf2AddMapRows, if these pay off for nor rows */
+{
+  if (FfOrder != 2 || nor < GF2_FOUR_RUSSIANS_MIN) return NULL;
+  pthread_once(&gf2KernelChosen, chooseGF2Kernel);
+  return (BYTE *) malloc(GF2_TABLES * 256 * FfCurrentRowSize);
+  /* If that fails, we simply go without the tables */
+}
+
+/******************************************************************************/
+static void composeBlock(group_t *group, PTR alpha, PTR beta, long r, long q,
+  long i, long kfrom, long kto, PTR scratch, BYTE *tables, PTR gamma,
+  unsigned long *count)
+/* gamma_ki += \sum_j beta_kj alpha_ji for kfrom <= k < kto, see
+   innerRightCompose. count[0], count[1], count[2] count the zero, monomial
+   and dense alpha_ji. Thread safe, once actionCacheOf has been called.
+*/
+{
+  long nontips = group->nontips;
+  long j, k, col = 0;
+  FEL coeff;
+  PTR alpha_ji = FfGetPtr(alpha, i * r), beta_kj, gamma_ki, mat;
+  PTR tmp = FfGetPtr(scratch, nontips);
+  actionCacheEntry_t *pin;
+  for (j = 0; j < r; j++, alpha_ji+=FfCurrentRowSize)
+  {
+    beta_kj = FfGetPtr(beta, kfrom + j * q);
+    gamma_ki = FfGetPtr(gamma, kfrom + i * q);
+    coeff = FF_ONE;
+    switch (rowSupport(alpha_ji, &col, &coeff))
+    {
+    case 0 :
+      count[0]++;
+      continue;
+    case 1 :
+      count[1]++;
+      if (col == 0)
+      { /* alpha_ji is a multiple of 1 */
+        for (k = kfrom; k < kto; k++, beta_kj+=FfCurrentRowSize, gamma_ki+=FfCurrentRowSize)
+          FfAddMulRow(gamma_ki, beta_kj, coeff);
+        continue;
+      }
+      /* Use the action matrix of the nontip, which all its multiples share */
+      FfMulRow(tmp, FF_ZERO);
+      FfInsert(tmp, col, FF_ONE);
+      mat = pinnedRightActionMatrix(group, tmp, scratch, &pin);
+      break;
+    default :
+      count[2]++;
+      mat = pinnedRightActionMatrix(group, alpha_ji, scratch, &pin);
+    }
+    if (tables)
+    { /* over GF(2), coeff is one */
+      gf2AddMapRows((BYTE *) beta_kj, kto - kfrom, (BYTE *) mat, nontips,
+        tables, (BYTE *) gamma_ki);
+    }
+    else
+      for (k = kfrom; k < kto; k++, beta_kj+=FfCurrentRowSize, gamma_ki+=FfCurrentRowSize)
+      {
+        if (coeff == FF_ONE)
+          FfAddMapRow(beta_kj, mat, nontips, gamma_ki);
+        else
+        {
+          memcpy(tmp, beta_kj, FfCurrentRowSize);
+          FfMulRow(tmp, coeff);
+          FfAddMapRow(tmp, mat, nontips, gamma_ki);
+        }
+      }
+    unpinAction(group, pin);
+  }
+  return;
+}
+
+struct composeJob
+{
+  group_t *group;
+  PTR alpha, beta, gamma, scratch;
+  long r, q;
+  long parts; /* item t is block i = t / parts, part t % parts of the k */
+  boolean *done;
+  unsigned long count[3];
+  pthread_mutex_t lock;
+};
+
+/******************************************************************************/
+static void composeRange(void *data, long from, long to)
+{
+  struct composeJob *job = (struct composeJob *) data;
+  long nontips = job->group->nontips;
+  long q = job->q, t, part, kfrom, kto;
+  long partSize = (q + job->parts - 1) / job->parts;
+  unsigned long count[3] = {0, 0, 0}, ignored[3] = {0, 0, 0};
+  PTR scratch = (from == 0) ? job->scratch :
+    (PTR) malloc((nontips + 1) * FfCurrentRowSize);
+  BYTE *tables;
+  if (!scratch) return; /* the calling thread will do this range */
+  tables = gf2FourRussiansTables(partSize);
+  for (t = from; t < to; t++)
+  {
+    part = t % job->parts;
+    kfrom = part * partSize;
+    kto = (kfrom + partSize < q) ? kfrom + partSize : q;
+    if (kfrom < kto)
+      composeBlock(job->group, job->alpha, job->beta, job->r, q,
+        t / job->parts, kfrom, kto, scratch, tables, job->gamma,
+        (part == 0) ? count : ignored); /* count each alpha_ji once */
+    job->done[t] = true;
+  }
+  free(tables);
+  if (scratch != job->scratch) free(scratch);
+  pthread_mutex_lock(&job->lock);
+  for (t = 0; t < 3; t++) job->count[t] += count[t];
+  pthread_mutex_unlock(&job->lock);
+  return;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int parallelInnerRightCompose(group_t *group, PTR alpha, PTR beta,
+  long s, long r, long q, PTR scratch, PTR gamma)
+/* innerRightCompose, the output blocks gamma_ki being shared out among the
+ * threads, with a scratch space each. If s is small, the rows of each block
+ * are split as well. Nothing has been done on error. */
+{
+  struct composeJob job;
+  long threads = numberOfThreads(), items, t;
+  job.group = group;
+  job.alpha = alpha;
+  job.beta = beta;
+  job.gamma = gamma;
+  job.scratch = scratch;
+  job.r = r;
+  job.q = q;
+  job.parts = (s >= threads) ? 1 : (threads + s - 1) / s;
+  if (job.parts > q) job.parts = q;
+  items = s * job.parts;
+  job.done = (boolean *) calloc(items, sizeof(boolean));
+  if (!job.done) return 1;
+  job.count[0] = job.count[1] = job.count[2] = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  if (runInParallel(items, composeRange, &job))
+  {
+    pthread_mutex_destroy(&job.lock);
+    free(job.done);
+    return 1;
+  }
+  /* Ranges whose thread had no scratch space */
+  for (t = 0; t < items; t++)
+    if (!job.done[t]) composeRange(&job, t, t + 1);
+  pthread_mutex_destroy(&job.lock);
+  free(job.done);
+  group->composedZero += job.count[0];
+  group->composedMonomial += job.count[1];
+  group->composedDense += job.count[2];
+  return 0;
+}
+
 /******************************************************************************/
 void innerRightCompose(group_t *group, PTR alpha, PTR beta, long s, long r,
   long q, PTR scratch, PTR gamma)
@@ -1104,29 +1922,26 @@ void innerRightCompose(group_t *group, PTR alpha, PTR beta, long s, long r,
    gamma must be initialised before calling innerCompose
    scratch: scratch space, nontips+1 rows
    Right: use right action matrix of alpha_ji
+   Zero alpha_ji are skipped, and multiples of a nontip use the action matrix
+   of that nontip; see group->composedZero etc. for how often this happened
+   With numberOfThreads() > 1, the blocks gamma_ki are computed in parallel
 */
 {
-  long nontips = group->nontips;
-  long i,j,k;
-  PTR alpha_ji, beta_kj, gamma_ki;
-  PTR mat = scratch, tmp = FfGetPtr(scratch, nontips);
-  alpha_ji = alpha;
+  unsigned long count[3] = {0, 0, 0};
+  BYTE *tables;
+  long i;
+  actionCacheOf(group);
+  if (numberOfThreads() > 1 && s * q > 1 &&
+      !parallelInnerRightCompose(group, alpha, beta, s, r, q, scratch, gamma))
+    return;
+  tables = gf2FourRussiansTables(q);
   for (i = 0; i < s; i++)
-  {
-    beta_kj = beta;
-    for (j = 0; j < r; j++, alpha_ji+=FfCurrentRowSize)
-    {
-      /*alpha_ji = FfGetPtr(alpha, j + i * r);*/
-      innerRightActionMatrix(group, alpha_ji, mat);
-      gamma_ki = FfGetPtr(gamma, i * q);
-      for (k = 0; k < q; k++, beta_kj+=FfCurrentRowSize, gamma_ki+=FfCurrentRowSize)
-      {
-        /*beta_kj = FfGetPtr(beta, k + j * q);
-        gamma_ki = FfGetPtr(gamma, k + i * q);*/
-        FfAddMapRow(beta_kj, mat, nontips, gamma_ki);
-      }
-    }
-  }
+    composeBlock(group, alpha, beta, r, q, i, 0, q, scratch, tables, gamma,
+      count);
+  free(tables);
+  group->composedZero += count[0];
+  group->composedMonomial += count[1];
+  group->composedDense += count[2];
   return;
 }
 
@@ -1596,7 +2411,8 @@ int calculateDimSteps(group_t *group)
 /****
  * NULL on error
  ***************************************************************************/
-group_t *fullyLoadedGroupRecord(char *stem)
+group_t *textLoadedGroupRecord(char *stem)
+/* Parses the .nontips file etc.; see also fullyLoadedGroupRecord */
 {
   group_t *G = namedGroupRecord(stem);
   if (!G) return NULL;
@@ -1642,6 +2458,510 @@ group_t *fullyLoadedGroupRecord(char *stem)
   return G;
 }
 
+/******************************************************************************
+ * A group bundle <stem>.grp holds all that fullyLoadedGroupRecord needs, in
+ * the layout used in memory, so that it can be mapped and used in place.
+ * After the header come the sections, each padded to a multiple of 8 bytes:
+ * the nontip strings, the path trees (parent, lastArrow, depth and dim of
+ * each node), the action matrices, the left action matrices, the basis
+ * change matrices (if known), the Jennings dimensions (if any) and dS.
+ * Matrices have rows of FfCurrentRowSize bytes. The checksum covers all
+ * that follows the header. The header also records the size and mtime of
+ * the files the bundle was made of, to tell whether it is still current.
+ * makeGroupBundle writes such files.
+ ******************************************************************************/
+
+#define GROUP_BUNDLE_MAGIC 0x4c444e4250524750L /* "PGRPBNDL" */
+#define GROUP_BUNDLE_VERSION 2
+#define BUNDLE_SOURCES 5
+
+static const char *bundleSource[BUNDLE_SOURCES] =
+  {".nontips", ".dims", ".gens", ".lgens", ".bch"};
+
+struct groupBundleHeader
+{
+  long magic, version;
+  unsigned long checksum;
+  long length;           /* of the file */
+  long arrows, nontips, maxlength, mintips, p, ordering;
+  long field, rowSize;   /* of the matrices */
+  long stringLength;     /* each nontip takes stringLength + 1 chars */
+  long numBch;           /* 0 or 2 */
+  long numDims;          /* entries of group->dim, or 0 */
+  long numDS;            /* entries of group->dS */
+  long nontipOffset, rootOffset, lrootOffset, actionOffset, lactionOffset,
+    bchOffset, dimOffset, dSOffset;
+  long sourceSize[BUNDLE_SOURCES];  /* -1 if there is no such file */
+  long sourceTime[BUNDLE_SOURCES];
+};
+
+#define TREE_FIELDS 4 /* parent, lastArrow, depth, dim */
+
+/******************************************************************************/
+static inline size_t bundlePadded(size_t n)
+{
+  return (n + 7) & ~((size_t) 7);
+}
+
+/******************************************************************************/
+static unsigned long bundleChecksum(unsigned long h, const char *data,
+  size_t length)
+/* length a multiple of 8 */
+{
+  unsigned long w;
+  size_t k;
+  for (k = 0; k < length; k += 8)
+  {
+    memcpy(&w, data + k, 8);
+    h = (h ^ w) * 1099511628211UL;
+  }
+  return h;
+}
+
+/******************************************************************************/
+char *groupBundleFile(const char *stem)
+{
+  static char buffer[MAXLINE];
+  strext(buffer, (char *) stem, ".grp");
+  return buffer;
+}
+
+/******************************************************************************/
+static void bundleSourceStamps(char *stem, long *size, long *time)
+{
+  char name[MAXLINE];
+  struct stat st;
+  long i;
+  for (i = 0; i < BUNDLE_SOURCES; i++)
+  {
+    strext(name, stem, (char *) bundleSource[i]);
+    if (stat(name, &st)) size[i] = time[i] = -1;
+    else
+    {
+      size[i] = st.st_size;
+      time[i] = st.st_mtime;
+    }
+  }
+  return;
+}
+
+/******************************************************************************/
+static boolean groupBundleIsCurrent(char *stem)
+/* true if <stem>.grp exists and the files it was made of still have the
+ * size and mtime (in seconds) recorded when it was saved. This catches any
+ * change of size, and any rewrite in a later second than the recorded one,
+ * even if that is the second the bundle was saved in; a rewrite of the
+ * same size within the recorded second goes unnoticed. */
+{
+  struct groupBundleHeader head;
+  long size[BUNDLE_SOURCES], time[BUNDLE_SOURCES], i;
+  FILE *fp = fopen(groupBundleFile(stem), "rb");
+  if (!fp) return false;
+  i = fread(&head, sizeof(head), 1, fp);
+  fclose(fp);
+  if (i != 1 || head.magic != GROUP_BUNDLE_MAGIC ||
+      head.version != GROUP_BUNDLE_VERSION)
+    return false;
+  bundleSourceStamps(stem, size, time);
+  for (i = 0; i < BUNDLE_SOURCES; i++)
+    if (size[i] != head.sourceSize[i] || time[i] != head.sourceTime[i])
+      return false;
+  return true;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeBundleSection(FILE *fp, const void *data, size_t length,
+  struct groupBundleHeader *head, long *offset)
+{
+  static const char zero[8] = {0};
+  size_t padded = bundlePadded(length);
+  char *buffer = (char *) malloc(padded ? padded : 1);
+  if (!buffer)
+  {
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  memcpy(buffer, data, length);
+  memcpy(buffer + length, zero, padded - length);
+  *offset = head->length;
+  if (fwrite(buffer, 1, padded, fp) != padded)
+  {
+    free(buffer);
+    MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  head->checksum = bundleChecksum(head->checksum, buffer, padded);
+  head->length += padded;
+  free(buffer);
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeBundleTree(FILE *fp, group_t *group, path_t *root,
+  struct groupBundleHeader *head, long *offset)
+{
+  long nontips = group->nontips, i;
+  long *tree = (long *) malloc(TREE_FIELDS * nontips * sizeof(long));
+  int r;
+  if (!tree)
+  {
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  for (i = 0; i < nontips; i++)
+  {
+    tree[TREE_FIELDS * i] = (root[i].parent) ? root[i].parent->index : -1;
+    tree[TREE_FIELDS * i + 1] = (i) ? root[i].lastArrow : -1;
+    tree[TREE_FIELDS * i + 2] = root[i].depth;
+    tree[TREE_FIELDS * i + 3] = root[i].dim;
+  }
+  r = writeBundleSection(fp, tree, TREE_FIELDS * nontips * sizeof(long),
+    head, offset);
+  free(tree);
+  return r;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int writeBundleMatrices(FILE *fp, group_t *group, Matrix_t **mat,
+  long num, struct groupBundleHeader *head, long *offset)
+/* In one section without padding in between, as matrixListAt wants them */
+{
+  size_t size = group->nontips * FfCurrentRowSize;
+  char *data;
+  long i;
+  int r;
+  if (!num)
+  {
+    *offset = head->length;
+    return 0;
+  }
+  data = (char *) malloc(num * size);
+  if (!data)
+  {
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  for (i = 0; i < num; i++) memcpy(data + i * size, mat[i]->Data, size);
+  r = writeBundleSection(fp, data, num * size, head, offset);
+  free(data);
+  return r;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int saveGroupBundle(group_t *group)
+/* Writes <stem>.grp; group must be fully loaded, with or without bch.
+ * Via a temporary file, so that <stem>.grp is complete once it exists */
+{
+  struct groupBundleHeader head;
+  long nontips = group->nontips;
+  char tmpfile[MAXLINE + 4];
+  FILE *fp;
+  if (!group->root || !group->lroot || !group->action || !group->laction ||
+      !group->dS)
+  {
+    MTX_ERROR1("group not fully loaded: %E", MTX_ERR_INCOMPAT);
+    return 1;
+  }
+  memset(&head, 0, sizeof(head));
+  head.magic = GROUP_BUNDLE_MAGIC;
+  head.version = GROUP_BUNDLE_VERSION;
+  head.checksum = 14695981039346656037UL;
+  head.length = sizeof(head);
+  head.arrows = group->arrows;
+  head.nontips = nontips;
+  head.maxlength = group->maxlength;
+  head.mintips = group->mintips;
+  head.p = group->p;
+  head.ordering = group->ordering;
+  head.field = group->action[0]->Field;
+  FfSetField(head.field);
+  FfSetNoc(nontips);
+  head.rowSize = FfCurrentRowSize;
+  head.stringLength = (group->maxlength >= 3) ? group->maxlength : 3;
+  head.numBch = (group->bch) ? 2 : 0;
+  bundleSourceStamps(group->stem, head.sourceSize, head.sourceTime);
+  head.numDims = (group->dim) ? group->dim[0] + 1 : 0;
+  if (group->ordering == 'R') head.numDS = group->maxlength + 3;
+  else
+    for (head.numDS = 1; group->dS[head.numDS - 1] < nontips; head.numDS++);
+  sprintf(tmpfile, "%s.tmp", groupBundleFile(group->stem));
+  fp = fopen(tmpfile, "wb");
+  if (!fp)
+  {
+    MTX_ERROR2("%s: %E", tmpfile, MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (fwrite(&head, sizeof(head), 1, fp) != 1 ||
+      writeBundleSection(fp, group->nontip[0],
+        nontips * (head.stringLength + 1), &head, &head.nontipOffset) ||
+      writeBundleTree(fp, group, group->root, &head, &head.rootOffset) ||
+      writeBundleTree(fp, group, group->lroot, &head, &head.lrootOffset) ||
+      writeBundleMatrices(fp, group, group->action, group->arrows, &head,
+        &head.actionOffset) ||
+      writeBundleMatrices(fp, group, group->laction, group->arrows, &head,
+        &head.lactionOffset) ||
+      writeBundleMatrices(fp, group, group->bch, head.numBch, &head,
+        &head.bchOffset) ||
+      writeBundleSection(fp, group->dim, head.numDims * sizeof(long), &head,
+        &head.dimOffset) ||
+      writeBundleSection(fp, group->dS, head.numDS * sizeof(long), &head,
+        &head.dSOffset) ||
+      fseek(fp, 0, SEEK_SET) || fwrite(&head, sizeof(head), 1, fp) != 1)
+  {
+    fclose(fp);
+    remove(tmpfile);
+    MTX_ERROR1("cannot write group bundle: %E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (fclose(fp) || rename(tmpfile, groupBundleFile(group->stem)))
+  {
+    remove(tmpfile);
+    MTX_ERROR2("%s: %E", groupBundleFile(group->stem), MTX_ERR_FILEFMT);
+    return 1;
+  }
+  return 0;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+static path_t *bundledPathTree(group_t *group, long *tree)
+{
+  path_t *root = allocatePathTree(group), *this;
+  long i;
+  if (!root) return NULL;
+  for (i = 0; i < group->nontips; i++, tree += TREE_FIELDS)
+  {
+    this = root + i;
+    if (i)
+    {
+      if (tree[0] < 0 || tree[0] >= group->nontips || tree[0] == i ||
+          tree[1] < 0 || tree[1] >= group->arrows ||
+          root[tree[0]].child[tree[1]])
+      {
+        freeRoot(root);
+        MTX_ERROR1("group bundle damaged: %E", MTX_ERR_FILEFMT);
+        return NULL;
+      }
+      this->path = group->nontip[i];
+      this->parent = root + tree[0];
+      this->lastArrow = tree[1];
+      this->parent->child[this->lastArrow] = this;
+    }
+    this->depth = tree[2];
+    this->dim = tree[3];
+  }
+  return root;
+}
+
+/******************************************************************************/
+static void releaseGroupBundle(group_t *group)
+/* Frees what points into the bundle, and the bundle itself */
+{
+  if (group->nontip) free(group->nontip);
+  if (group->root) freeRoot(group->root);
+  if (group->lroot) freeRoot(group->lroot);
+  if (group->action) { free(group->action[0]); free(group->action); }
+  if (group->laction) { free(group->laction[0]); free(group->laction); }
+  if (group->bch) { free(group->bch[0]); free(group->bch); }
+  group->nontip = NULL;
+  group->root = group->lroot = NULL;
+  group->action = group->laction = group->bch = NULL;
+  group->dim = group->dS = NULL;
+#ifdef HAVE_MMAP
+  if (group->bundleMapped) munmap(group->bundle, group->bundleLength);
+  else
+#endif
+  free(group->bundle);
+  group->bundle = NULL;
+}
+
+/******************************************************************************/
+static boolean bundleSectionFits(struct groupBundleHeader *head, long offset,
+  long count, long size)
+/* true if count items of size bytes at offset lie within the file */
+{
+  if (offset < (long) sizeof(*head) || offset % 8 || offset > head->length ||
+      count < 0 || size <= 0)
+    return false;
+  return (count <= (head->length - offset) / size);
+}
+
+/******************************************************************************/
+static boolean bundleHeaderIsSound(struct groupBundleHeader *head)
+/* true if the counts are sane and all sections lie within the file */
+{
+  long nontips = head->nontips, matrix;
+  if (head->arrows < 1 || nontips < 1 || head->rowSize < 1 ||
+      head->stringLength < 3 || (head->numBch != 0 && head->numBch != 2) ||
+      head->numDims < 0 || head->numDS < 1 ||
+      nontips > head->length / head->rowSize)
+    return false;
+  matrix = nontips * head->rowSize;
+  return bundleSectionFits(head, head->nontipOffset, nontips,
+           head->stringLength + 1) &&
+    bundleSectionFits(head, head->rootOffset, nontips,
+      TREE_FIELDS * sizeof(long)) &&
+    bundleSectionFits(head, head->lrootOffset, nontips,
+      TREE_FIELDS * sizeof(long)) &&
+    bundleSectionFits(head, head->actionOffset, head->arrows, matrix) &&
+    bundleSectionFits(head, head->lactionOffset, head->arrows, matrix) &&
+    (!head->numBch ||
+     bundleSectionFits(head, head->bchOffset, head->numBch, matrix)) &&
+    (!head->numDims ||
+     bundleSectionFits(head, head->dimOffset, head->numDims, sizeof(long))) &&
+    bundleSectionFits(head, head->dSOffset, head->numDS, sizeof(long));
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int readGroupBundle(group_t *group, struct groupBundleHeader *head)
+/* Maps <stem>.grp, or reads it into memory, and checks it */
+{
+  struct stat st;
+  FILE *fp = fopen(groupBundleFile(group->stem), "rb");
+  if (!fp)
+  {
+    MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (fread(head, sizeof(*head), 1, fp) != 1 ||
+      head->magic != GROUP_BUNDLE_MAGIC || head->version != GROUP_BUNDLE_VERSION)
+  {
+    fclose(fp);
+    MTX_ERROR1("not a group bundle of this version: %E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  /* A short file would fault when mapped */
+  if (fstat(fileno(fp), &st) || head->length != (long) st.st_size ||
+      !bundleHeaderIsSound(head))
+  {
+    fclose(fp);
+    MTX_ERROR1("group bundle damaged: %E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  group->bundleLength = head->length;
+  group->bundleMapped = false;
+#ifdef HAVE_MMAP
+  /* private, so that a caller altering a matrix does not alter the file */
+  group->bundle = (char *) mmap(NULL, group->bundleLength,
+    PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fp), 0);
+  if (group->bundle == (char *) MAP_FAILED) group->bundle = NULL;
+  else group->bundleMapped = true;
+#endif
+  if (!group->bundle)
+  {
+    group->bundle = (char *) malloc(group->bundleLength);
+    if (!group->bundle || fseek(fp, 0, SEEK_SET) ||
+        fread(group->bundle, 1, group->bundleLength, fp) !=
+          group->bundleLength)
+    {
+      if (group->bundle) free(group->bundle);
+      group->bundle = NULL;
+      fclose(fp);
+      MTX_ERROR1("cannot read group bundle: %E", MTX_ERR_FILEFMT);
+      return 1;
+    }
+  }
+  fclose(fp);
+  if (bundleChecksum(14695981039346656037UL, group->bundle + sizeof(*head),
+        group->bundleLength - sizeof(*head)) != head->checksum)
+  {
+    releaseGroupBundle(group);
+    MTX_ERROR1("group bundle damaged: %E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int loadGroupBundle(group_t *group)
+/* Loads all that fullyLoadedGroupRecord loads, and bch if known, from
+ * <stem>.grp. The nontips, matrices, dim and dS stay in the bundle. */
+{
+  struct groupBundleHeader head;
+  char *b;
+  long i;
+  if (readGroupBundle(group, &head)) return 1;
+  b = group->bundle;
+  group->arrows = head.arrows;
+  group->nontips = head.nontips;
+  group->maxlength = head.maxlength;
+  group->mintips = head.mintips;
+  group->p = head.p;
+  group->ordering = (char) head.ordering;
+  FfSetField(head.field);
+  FfSetNoc(head.nontips);
+  if ((long) FfCurrentRowSize != head.rowSize)
+  {
+    releaseGroupBundle(group);
+    MTX_ERROR1("group bundle made for another row size: %E", MTX_ERR_INCOMPAT);
+    return 1;
+  }
+  group->nontip = (char **) malloc(head.nontips * sizeof(void*));
+  if (!group->nontip)
+  {
+    releaseGroupBundle(group);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return 1;
+  }
+  for (i = 0; i < head.nontips; i++)
+    group->nontip[i] = b + head.nontipOffset + i * (head.stringLength + 1);
+  group->dim = (head.numDims) ? (long *) (b + head.dimOffset) : NULL;
+  group->dS = (long *) (b + head.dSOffset);
+  for (i = 0; i < head.nontips &&
+         memchr(group->nontip[i], '\0', head.stringLength + 1); i++);
+  if (i < head.nontips || group->dS[head.numDS - 1] < head.nontips ||
+      (group->dim && group->dim[0] != head.numDims - 1))
+  {
+    releaseGroupBundle(group);
+    MTX_ERROR1("group bundle damaged: %E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (!(group->root = bundledPathTree(group, (long *) (b + head.rootOffset)))
+      || !(group->lroot =
+             bundledPathTree(group, (long *) (b + head.lrootOffset)))
+      || !(group->action =
+             matrixListAt(group, b + head.actionOffset, head.arrows))
+      || !(group->laction =
+             matrixListAt(group, b + head.lactionOffset, head.arrows))
+      || (head.numBch && !(group->bch =
+             matrixListAt(group, b + head.bchOffset, head.numBch))))
+  {
+    releaseGroupBundle(group);
+    return 1;
+  }
+  return 0;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+group_t *fullyLoadedGroupRecord(char *stem)
+/* From <stem>.grp if that is up to date, else from the text files */
+{
+  group_t *G;
+  if (groupBundleIsCurrent(stem))
+  {
+    G = namedGroupRecord(stem);
+    if (!G) return NULL;
+    if (!loadGroupBundle(G)) return G;
+    freeGroupRecord(G); /* fall back to the text files */
+  }
+  return textLoadedGroupRecord(stem);
+}
+
 /****
  * Potential error if -1 is returned
  ***************************************************************************/
@@ -25,6 +25,7 @@
 
 #include "pcommon.h"
 #include "meataxe.h"
+#include <pthread.h>
 
 typedef int boolean;
 static const boolean true = 1;
@@ -50,6 +51,34 @@ struct pathnode
   long dim;   /* Dimension of path, for Jennings case */
 };
 
+struct actionCacheEntry;
+typedef struct actionCacheEntry actionCacheEntry_t;
+
+struct actionCacheEntry
+{
+  unsigned long hash;
+  PTR key;     /* the vector; its action matrix follows in the next rows */
+  long users;  /* threads using the matrix at the moment */
+  boolean ready; /* false while the matrix is being computed */
+  actionCacheEntry_t *nextInBucket;
+  actionCacheEntry_t *newer, *older;
+};
+
+struct actionCache; /* see cachedRightActionMatrix */
+typedef struct actionCache actionCache_t;
+
+struct actionCache
+{
+  long noc;               /* FfNoc when the entries were made */
+  size_t memory, cap;     /* bytes in use, and allowed */
+  unsigned long numBuckets; /* a power of two */
+  actionCacheEntry_t **bucket;
+  actionCacheEntry_t *newest, *oldest;
+  unsigned long hits, misses;
+  pthread_mutex_t lock;
+  pthread_cond_t built; /* signalled when an entry becomes ready */
+};
+
 struct groupRecord
 {
   char *stem;
@@ -67,6 +96,12 @@ struct groupRecord
   Matrix_t **bch;
   long *dim;
   long *dS;           /* depth Steps: for resolution only */
+  actionCache_t *rcache; /* right action matrices of recent vectors */
+  unsigned long composedZero, composedMonomial, composedDense;
+    /* blocks alpha_ji met by innerRightCompose, by number of nonzero entries */
+  char *bundle;       /* <stem>.grp, if loaded from there; see loadGroupBundle */
+  size_t bundleLength;
+  boolean bundleMapped;
 };
 
 typedef struct groupRecord group_t;
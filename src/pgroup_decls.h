@@ -110,6 +110,10 @@ void innerLeftActionMatrix(group_t *group, PTR vec, PTR dest);
 extern Matrix_t *leftActionMatrix(group_t *group, PTR vec);
 void innerRightActionMatrix(group_t *group, PTR vec, PTR dest);
 extern Matrix_t *rightActionMatrix(group_t *group, PTR vec);
+void setActionCacheMemory(size_t bytes);
+size_t actionCacheMemoryDefault(void);
+PTR cachedRightActionMatrix(group_t *group, PTR vec, PTR scratch);
+void freeActionCache(group_t *group);
 extern int loadActionMatrices(group_t *group);
 extern int loadLeftActionMatrices(group_t *group);
 
@@ -158,9 +162,18 @@ int changeActionMatricesReg2Nontips(group_t *group);
 long pathTreeGirth(group_t *group);
 int calculateDimSteps(group_t *group);
 group_t *fullyLoadedGroupRecord(char *stem);
+group_t *textLoadedGroupRecord(char *stem);
+char *groupBundleFile(const char *stem);
+int saveGroupBundle(group_t *group);
+int loadGroupBundle(group_t *group);
 
 extern boolean fileExists(const char *name);
 
+void setNumberOfThreads(long n);
+long numberOfThreads(void);
+int runInParallel(long n, void (*job)(void *data, long from, long to),
+  void *data);
+
 int verifyGroupIsAbelian(group_t *A);
 
 long *newLongArray(long N);
@@ -18,18 +18,30 @@
     along with p_group_cohomoloy.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 /*
-*  slice.c : Methods for the disk-based slice product storage system
+*  slice.c : Methods for the slice product storage system
 *  Author: David J Green
 *  First version: 16 March 2000 from urbild.c
 */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 #include "nDiag.h"
 #include "fp_decls.h"
 #include "meataxe.h"
 #include <stdio.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 MTX_DEFINE_FILE_INFO
 
+/* A .stp file has the usual header, padded to STP_DATA_OFFSET bytes, and
+ * then rows of FfCurrentRowSize bytes, not FfCurrentRowSizeIo. So the rows
+ * are aligned in a mapping of the file and can be used where they are. */
+#define STP_DATA_OFFSET 16
+
 /*******************************************************************************
 * static long layerSize(ngs_t *ngs, group_t *group, long dim)
 {
@@ -45,51 +57,82 @@ MTX_DEFINE_FILE_INFO
 * }
 */
 
+/****
+ * NULL on error
+ ***************************************************************************/
+void *allocatePoolChunk(ngs_t *ngs, size_t bytes)
+/* Zeroed memory that belongs to ngs until freeNgs */
+{
+  poolChunk_t *chunk = (poolChunk_t *) malloc(sizeof(poolChunk_t));
+  if (chunk) chunk->mem = calloc(1, bytes);
+  if (!chunk || !chunk->mem)
+  {
+    if (chunk) free(chunk);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  chunk->next = ngs->poolChunks;
+  ngs->poolChunks = chunk;
+  return chunk->mem;
+}
+
 /******************************************************************************/
-void freeGeneralVector(gV_t *gv)
+void freePoolChunks(ngs_t *ngs)
 {
-  if (gv->w) free(gv->w);
-  free(gv);
+  poolChunk_t *chunk, *next;
+  for (chunk = ngs->poolChunks; chunk; chunk = next)
+  {
+    next = chunk->next;
+    free(chunk->mem);
+    free(chunk);
+  }
+  ngs->poolChunks = NULL;
+  ngs->freeGeneral = NULL;
+  ngs->freeUnreduced = NULL;
+  ngs->freeReduced = NULL;
+}
+
+/******************************************************************************/
+void pushGeneralVector(ngs_t *ngs, gV_t *gv)
+/* Returns gv to the pool of ngs */
+{
+  gv->next = ngs->freeGeneral;
+  ngs->freeGeneral = gv;
   return;
 }
 
+/****
+ * 1 on error
+ ***************************************************************************/
+static int growGeneralVectorPool(ngs_t *ngs)
+{
+  size_t rowBytes = (size_t) (ngs->r + ngs->s) * FfCurrentRowSize;
+  gV_t *gv = (gV_t *) allocatePoolChunk(ngs, VECTOR_POOL_CHUNK * sizeof(gV_t));
+  PTR w = gv ? (PTR) allocatePoolChunk(ngs, VECTOR_POOL_CHUNK * rowBytes) : NULL;
+  register long i;
+  if (!w) return 1;
+  for (i = 0; i < VECTOR_POOL_CHUNK; i++, w += rowBytes)
+  {
+    gv[i].w = w;
+    pushGeneralVector(ngs, gv + i);
+  }
+  return 0;
+}
+
 /****
  * NULL on error
  ***************************************************************************/
-inline gV_t *generalVectorTemplate(long nor)
+gV_t *popGeneralVector(ngs_t *ngs)
+/* A vector of r+s rows from the pool of ngs; the rows are not cleared */
 {
   gV_t *gv;
-  PTR w;
-  gv = (gV_t *) malloc(sizeof(gV_t));
-  if (!gv)
-      {
-          MTX_ERROR1("%E", MTX_ERR_NOMEM);
-          return NULL;
-      }
-  w = FfAlloc(nor);
-  if (!w)
-      {
-          MTX_ERROR1("%E", MTX_ERR_NOMEM);
-          return NULL;
-      }
-  gv->w = w;
+  if (!ngs->freeGeneral && growGeneralVectorPool(ngs)) return NULL;
+  gv = ngs->freeGeneral;
+  ngs->freeGeneral = gv->next;
   gv->radical = true; /* "default" value */
   return gv;
 }
 
-/******************************************************************************/
-void pushGeneralVector(ngs_t *ngs, gV_t *gv)
-{
-  if (ngs->gVwaiting)
-  {
-    printf("Warning: pushGeneralVector discarding\n");
-    freeGeneralVector(gv);
-  }
-  else
-    ngs->gVwaiting = gv;
-  return;
-}
-
 /***
  * 1 on error
  ****************************************************************************/
@@ -171,6 +214,20 @@ int multiply(PTR row, Matrix_t *mat, PTR result, long r)
   }
 //~ }
 
+/******************************************************************************/
+void multiplyRows(PTR row, Matrix_t *mat, PTR result, long r)
+/* Same result as multiply, but computed row by row with FfMapRow.
+ * Allocates nothing and leaves the field settings alone, so several threads
+ * may call it at once. FfOrder and FfNoc must already fit mat. */
+{
+  register long i;
+  register PTR p1 = row;
+  register PTR p2 = result;
+  for (i = 0; i < r; i++, p1+=FfCurrentRowSize, p2+=FfCurrentRowSize)
+    FfMapRow(p1, mat->Data, mat->Nor, p2);
+  return;
+}
+
 /****
  * 1 on error
  ***************************************************************************/
@@ -178,36 +235,26 @@ int createWordForest(ngs_t *ngs, group_t *group)
 /* There is a separate routine to initialize */
 /* Forest contains ngs->r trees */
 {
-  register long i, j, k;
+  register long i, j;
   long nodes = group->nontips;
-  long arrows = group->arrows;
   long r = ngs->r;
   //  modW_t **proot = (modW_t **) malloc(r * sizeof(modW_t *));
   modW_t **proot = (modW_t **) malloc(r * sizeof(void*));
   modW_t *proot0 = (modW_t *) malloc(r * nodes * sizeof(modW_t));
-  //  modW_t **kinder = (modW_t **) malloc(r * arrows * nodes * sizeof(modW_t *));
-  modW_t **kinder = (modW_t **) malloc(r * arrows * nodes * sizeof(void*));
   modW_t *node;
-  if (!proot || !proot0 || !kinder)
+  if (!proot || !proot0)
     { MTX_ERROR1("%E", MTX_ERR_NOMEM);
       return 1;
     }
-  for (i = 0; i < r * arrows * nodes; i++)
-    kinder[i] = NULL;
   for (i = 0; i < r; i++)
   {
     proot[i] = proot0 + i * nodes;
     for (j = 0; j < nodes; j++)
     {
       node = proot[i] + j;
-      node->child =
-        kinder + ((i * nodes + j) * arrows);
+      node->parent = NULL;
       node->divisor = NULL;
       node->status = NO_DIVISOR;
-      for (k = 0; k < arrows; k++)
-        if (group->root[j].child[k] != NULL)
-          node->child[k] =
-            proot[i] + group->root[j].child[k]->index;
     }
   }
   ngs->proot = proot;
@@ -219,7 +266,6 @@ Simon King (2008-12) this function occurs only once, hence, insert it manually
 void freeWordForest(ngs_t *ngs)
 {
   modW_t **proot = ngs->proot;
-  free(proot[0][0].child);
   free(proot[0]);
   free(proot);
   return;
@@ -249,25 +295,370 @@ static int updateWordStatusData(ngs_t *ngs, group_t *group)
   return 0;
 }
 
+static size_t sliceMemoryBudget = SLICE_MEMORY_BUDGET;
+
+/******************************************************************************/
+void setSliceMemoryBudget(size_t bytes)
+/* Bytes of products each generating set allocated from now on may keep in
+ * RAM. A slice that does not fit into what is left goes to a .stp file.
+ * 0 means that all slices are stored on disk. */
+{
+  sliceMemoryBudget = bytes;
+}
+
+/******************************************************************************/
+size_t sliceMemoryBudgetDefault(void)
+{
+  return sliceMemoryBudget;
+}
+
+static long blockCacheSize = BLOCK_CACHE_SIZE;
+
+/******************************************************************************/
+void setBlockCacheSize(long n)
+/* Number of blocks of an unmapped .stp file that each generating set
+ * allocated from now on keeps in RAM, least recently used out first */
+{
+  blockCacheSize = (n < 1) ? 1 : n;
+}
+
+/******************************************************************************/
+long blockCacheSizeDefault(void)
+{
+  return blockCacheSize;
+}
+
+static long blockSize = AUTO_BLOCK_SIZE;
+
 /******************************************************************************/
-static char *storedProductFile(ngs_t *ngs, long dim)
-/* String returned must be used at once, never reused, never freed. */
+void setBlockSize(long n)
+/* Products per block for each generating set allocated from now on: the
+ * rows of theseProds and prodScratch are n * (r+s), and so are those of each
+ * slot of the block cache and of each read from an unmapped .stp file.
+ * AUTO_BLOCK_SIZE chooses it for each generating set, see blockSizeDefault */
+{
+  blockSize = (n < 1) ? AUTO_BLOCK_SIZE : n;
+}
+
+/******************************************************************************/
+static size_t availableMemory(void)
+/* Bytes of physical memory, or 0 if unknown. All of it rather than what is
+ * free at the moment, so that the block size does not depend on the load of
+ * the machine and a run can be repeated */
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && pageSize > 0) return (size_t) pages * pageSize;
+#endif
+  return 0;
+}
+
+/******************************************************************************/
+long blockSizeDefault(long nor)
+/* For a generating set with products of nor rows. Chosen automatically, a
+ * block takes about BLOCK_BYTES, but the 2 + cacheSize blocks of the set
+ * take at most the BLOCK_MEMORY_SHARE-th part of the physical memory */
+{
+  size_t productBytes = (size_t) nor * FfCurrentRowSize;
+  size_t bytes = BLOCK_BYTES, avail = availableMemory();
+  long n;
+  if (blockSize != AUTO_BLOCK_SIZE) return blockSize;
+  if (avail && avail / BLOCK_MEMORY_SHARE / (2 + blockCacheSize) < bytes)
+    bytes = avail / BLOCK_MEMORY_SHARE / (2 + blockCacheSize);
+  n = (productBytes) ? bytes / productBytes : MAX_BLOCK_SIZE;
+  if (n < MIN_BLOCK_SIZE) n = MIN_BLOCK_SIZE;
+  if (n > MAX_BLOCK_SIZE) n = MAX_BLOCK_SIZE;
+  return n;
+}
+
+/****
+ * negative on error
+ ***************************************************************************/
+static double blockThroughput(group_t *group, long nor, long bs, char *file)
+/* Products per second for block size bs: computed a block at a time by one
+ * multiplication per arrow, written to file, and read back a block at a
+ * time, CALIBRATION_BYTES worth of products in all */
+{
+  size_t productBytes = (size_t) nor * FfCurrentRowSize;
+  long blocks = CALIBRATION_BYTES / productBytes / bs, k, i;
+  PTR src = FfAlloc(bs * nor), dest = FfAlloc(bs * nor);
+  FILE *fp = NULL;
+  struct timespec start;
+  double seconds, rate = -1;
+  if (blocks < 1) blocks = 1;
+  if (!src || !dest)
+  {
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    goto done;
+  }
+  for (i = 0; i < bs * nor; i++)
+    memcpy(FfGetPtr(src, i), FfGetPtr(group->action[i % group->arrows]->Data,
+      i % group->nontips), FfCurrentRowSize);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  fp = fopen(file, "wb");
+  if (!fp)
+  {
+    MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+    goto done;
+  }
+  for (k = 0; k < blocks; k++)
+  {
+    if (multiply(src, group->action[k % group->arrows], dest, bs * nor))
+      goto done;
+    if (fwrite(dest, FfCurrentRowSize, bs * nor, fp) != (size_t) (bs * nor))
+    {
+      MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+      goto done;
+    }
+  }
+  fclose(fp);
+  fp = fopen(file, "rb");
+  if (!fp)
+  {
+    MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+    goto done;
+  }
+  for (k = 0; k < blocks; k++)
+    if (fread(src, FfCurrentRowSize, bs * nor, fp) != (size_t) (bs * nor))
+    {
+      MTX_ERROR2("%s: %E", file, MTX_ERR_FILEFMT);
+      goto done;
+    }
+  seconds = secondsSince(&start);
+  rate = (double) blocks * bs / ((seconds > 0) ? seconds : 1e-9);
+done:
+  if (fp) fclose(fp);
+  remove(file);
+  if (src) free(src);
+  if (dest) free(dest);
+  return rate;
+}
+
+/****
+ * 0 on error
+ ***************************************************************************/
+long calibrateBlockSize(group_t *group, long nor, char *stem)
+/* Tries each power of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE, as far as
+ * the blocks fit into memory as in blockSizeDefault, on what the block size
+ * decides: the batches of products and the reads and writes of .stp files,
+ * with products of nor rows. The one of highest throughput becomes the block
+ * size of each generating set allocated from now on, see setBlockSize.
+ * The scratch file is <stem>calib.stp. Returns the block size chosen. */
+{
+  char file[MAXLINE];
+  size_t productBytes, avail = availableMemory();
+  long bs, best = 0;
+  double rate, bestRate = 0;
+  FfSetField(group->action[0]->Field);
+  FfSetNoc(group->nontips);
+  productBytes = (size_t) nor * FfCurrentRowSize;
+  sprintf(file, "%scalib.stp", stem);
+  for (bs = MIN_BLOCK_SIZE; bs <= MAX_BLOCK_SIZE; bs *= 2)
+  {
+    if (best && avail &&
+        bs * productBytes * (2 + blockCacheSize) > avail / BLOCK_MEMORY_SHARE)
+      break;
+    rate = blockThroughput(group, nor, bs, file);
+    if (rate < 0) return 0;
+    if (rate > bestRate)
+    {
+      bestRate = rate;
+      best = bs;
+    }
+  }
+  setBlockSize(best);
+  return best;
+}
+
+/******************************************************************************/
+static char *storedProductFile(ngs_t *ngs, long dim, char *buffer)
+/* Writes the name to buffer, which must hold MAXLINE characters, and returns
+ * it; no static buffer, since several preimage engines may be alive at
+ * once (see newPreimageEngine) */
 {
-  static char buffer[MAXLINE];
   sprintf(buffer, "%s%ld.stp", ngs->stem, dim);
   return buffer;
 }
 
+/******************************************************************************/
+static inline size_t storedSliceBytes(ngs_t *ngs, slice_t *sl)
+{
+  return (size_t) sl->nops * (ngs->r + ngs->s) * FfCurrentRowSize;
+}
+
+/******************************************************************************/
+static slice_t *storedSlice(ngs_t *ngs, long dim)
+{
+  slice_t *sl;
+  for (sl = ngs->slices; sl; sl = sl->next)
+    if (sl->dim == dim) return sl;
+  return NULL;
+}
+
+/******************************************************************************/
+static void unloadStoredSlice(slice_t *sl)
+{
+#ifdef HAVE_MMAP
+  if (sl->map) munmap(sl->map, sl->mapLength);
+#endif
+  sl->map = NULL;
+  if (sl->fp) fclose(sl->fp);
+  sl->fp = NULL;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int loadStoredSlice(ngs_t *ngs, slice_t *sl)
+/* Opens the .stp file of sl and maps it, if possible. Otherwise the file
+ * stays open for loadBlock. */
+{
+  char file[MAXLINE];
+  long nor;
+  if (sl->where == SLICE_IN_RAM || sl->fp || sl->map || !sl->nops) return 0;
+  sl->fp = readhdrplus(storedProductFile(ngs, sl->dim, file), NULL, &nor, NULL);
+  if (!sl->fp) return 1;
+  if (nor != sl->nops * (ngs->r + ngs->s))
+  {
+    unloadStoredSlice(sl);
+    MTX_ERROR1("incorrect number of rows: %E", MTX_ERR_INCOMPAT);
+    return 1;
+  }
+#ifdef HAVE_MMAP
+  sl->mapLength = STP_DATA_OFFSET + (size_t) nor * FfCurrentRowSize;
+  sl->map = (char *) mmap(NULL, sl->mapLength, PROT_READ, MAP_SHARED,
+    fileno(sl->fp), 0);
+  if (sl->map == (char *) MAP_FAILED) sl->map = NULL;
+  else
+  {
+    fclose(sl->fp);
+    sl->fp = NULL;
+  }
+#endif
+  return 0;
+}
+
 /******************************************************************************
  * Return 1 on error
  */
-static int removeStoredProductFile(ngs_t *ngs, long d)
+static int removeStoredSlice(ngs_t *ngs, long d)
 {
-  if (remove(storedProductFile(ngs, d)))
-  { MTX_ERROR1("Cannot remove file %s", storedProductFile(ngs, d));
+  char file[MAXLINE];
+  slice_t **prev, *sl;
+  int r = 0;
+  for (prev = &ngs->slices; *prev && (*prev)->dim != d; prev = &(*prev)->next);
+  sl = *prev;
+  if (!sl)
+  { MTX_ERROR1("No stored products in dimension %d", d);
     return 1;
   }
-  return 0;
+  *prev = sl->next;
+  if (ngs->sliceLoaded == sl) ngs->sliceLoaded = NULL;
+  if (sl->where == SLICE_IN_RAM)
+  {
+    ngs->sliceMemory -= storedSliceBytes(ngs, sl);
+    if (sl->data) free(sl->data);
+  }
+  else
+  {
+    unloadStoredSlice(sl);
+    if (remove(storedProductFile(ngs, d, file)))
+    { MTX_ERROR1("Cannot remove file %s", storedProductFile(ngs, d, file));
+      r = 1;
+    }
+  }
+  free(sl);
+  return r;
+}
+
+/****
+ * NULL on error
+ ***************************************************************************/
+static slice_t *newStoredSlice(ngs_t *ngs, group_t *group, long dim, long nops)
+/* Space for nops products in dimension dim, replacing what was stored there.
+ * The slice is kept in RAM if it fits into what is left of ngs->sliceBudget,
+ * otherwise it is written to its .stp file. */
+{
+  char file[MAXLINE];
+  slice_t *sl;
+  size_t bytes;
+  if (storedSlice(ngs, dim) && removeStoredSlice(ngs, dim)) return NULL;
+  sl = (slice_t *) malloc(sizeof(slice_t));
+  if (!sl)
+  { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  sl->dim = dim;
+  sl->nops = nops;
+  sl->data = NULL;
+  sl->fp = NULL;
+  sl->map = NULL;
+  bytes = storedSliceBytes(ngs, sl);
+  if (ngs->sliceMemory + bytes <= ngs->sliceBudget &&
+      (!bytes || (sl->data = (PTR) malloc(bytes))))
+  {
+    sl->where = SLICE_IN_RAM;
+    ngs->sliceMemory += bytes;
+  }
+  else
+  {
+    sl->where = SLICE_IN_FILE;
+    static const char pad[STP_DATA_OFFSET - 12];
+    sl->fp = writehdrplus(storedProductFile(ngs, dim, file), FfOrder,
+      nops * (ngs->r + ngs->s), group->nontips);
+    if (!sl->fp)
+    { free(sl);
+      return NULL;
+    }
+    if (fwrite(pad, 1, sizeof(pad), sl->fp) != sizeof(pad))
+    { fclose(sl->fp);
+      free(sl);
+      MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+      return NULL;
+    }
+    ngs->stats.sliceFiles++;
+  }
+  sl->next = ngs->slices;
+  ngs->slices = sl;
+  return sl;
+}
+
+/******************************************************************************/
+static inline PTR storedSliceRow(slice_t *sl, long row)
+/* SLICE_IN_RAM, or SLICE_IN_FILE while mapped */
+{
+  if (sl->map)
+    return (PTR) (sl->map + STP_DATA_OFFSET + (size_t) row * FfCurrentRowSize);
+  return sl->data + (size_t) row * FfCurrentRowSize;
+}
+
+/******************************************************************************/
+void freeStoredSlices(ngs_t *ngs)
+/* Forgets all slices; .stp files are left alone */
+{
+  slice_t *sl, *next;
+  for (sl = ngs->slices; sl; sl = next)
+  {
+    next = sl->next;
+    if (sl->data) free(sl->data);
+    unloadStoredSlice(sl);
+    free(sl);
+  }
+  ngs->slices = NULL;
+  ngs->sliceLoaded = NULL;
+  ngs->sliceMemory = 0;
+}
+
+/******************************************************************************/
+static void forgetCachedBlocks(ngs_t *ngs)
+{
+  long slot;
+  for (slot = 0; slot < ngs->cacheSize; slot++)
+  {
+    ngs->cachedBlock[slot] = NONE;
+    ngs->cacheUsed[slot] = 0;
+  }
 }
 
 /****
@@ -279,9 +670,11 @@ int destroyCurrentDimension(ngs_t *ngs)
   { MTX_ERROR("no current dimension");
     return 1;
   }
-  if (ngs->dimLoaded != ngs->expDim)
-    { if (removeStoredProductFile(ngs, ngs->dimLoaded)) return 1; }
-  ngs->blockLoaded = NONE;
+  if (ngs->dimLoaded != ngs->expDim && !ngs->keepSlices)
+    { if (removeStoredSlice(ngs, ngs->dimLoaded)) return 1; }
+  else if (ngs->sliceLoaded) unloadStoredSlice(ngs->sliceLoaded);
+  ngs->sliceLoaded = NULL;
+  forgetCachedBlocks(ngs);
   ngs->dimLoaded = NONE;
   return 0;
 }
@@ -295,10 +688,132 @@ int destroyCurrentDimensionIfAny(ngs_t *ngs)
   return destroyCurrentDimension(ngs);
 }
 
+/******************************************************************************/
+void keepStoredSlices(ngs_t *ngs)
+/* From now on the slices of ngs outlive the sweep that computed them, and
+ * later sweeps load them instead of computing them again. This is only
+ * sound while the reduced vectors do not change, as for an urbild Groebner
+ * basis. */
+{
+  ngs->keepSlices = true;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int removeKeptSlices(ngs_t *ngs)
+/* Removes the slices kept since keepStoredSlices, and their .stp files */
+{
+  int r = destroyCurrentDimensionIfAny(ngs);
+  while (ngs->slices)
+    if (removeStoredSlice(ngs, ngs->slices->dim)) r = 1;
+  ngs->keepSlices = false;
+  return r;
+}
+
 /******************************************************************************/
 int destroyExpansionSliceFile(ngs_t *ngs)
 {
-  return removeStoredProductFile(ngs, ngs->expDim);
+  return removeStoredSlice(ngs, ngs->expDim);
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+static int copySliceRows(ngs_t *ngs, FILE *src, FILE *dest, long rows)
+/* Through theseProds, blockSize products at a time */
+{
+  long nor = ngs->r + ngs->s;
+  size_t n;
+  while (rows > 0)
+  {
+    n = (rows < ngs->blockSize * nor) ? rows : ngs->blockSize * nor;
+    if (fread(ngs->theseProds, FfCurrentRowSize, n, src) != n ||
+        fwrite(ngs->theseProds, FfCurrentRowSize, n, dest) != n)
+    {
+      MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+      return 1;
+    }
+    rows -= n;
+  }
+  return 0;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int saveExpansionProducts(ngs_t *ngs, FILE *fp)
+/* Writes dimension and number of products of the expansion slice to fp,
+ * followed by the products; NONE if there is no such slice. Assumes that
+ * no dimension is loaded. */
+{
+  char file[MAXLINE];
+  slice_t *sl = (ngs->expDim >= 0) ? storedSlice(ngs, ngs->expDim) : NULL;
+  long head[2], rows;
+  FILE *in;
+  int r;
+  head[0] = (sl) ? sl->dim : NONE;
+  head[1] = (sl) ? sl->nops : 0;
+  if (fwrite(head, sizeof(long), 2, fp) != 2)
+  {
+    MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (!sl || !sl->nops) return 0;
+  rows = sl->nops * (ngs->r + ngs->s);
+  if (sl->where == SLICE_IN_RAM)
+  {
+    if (fwrite(sl->data, FfCurrentRowSize, rows, fp) != (size_t) rows)
+    {
+      MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+      return 1;
+    }
+    return 0;
+  }
+  in = fopen(storedProductFile(ngs, sl->dim, file), "rb");
+  if (!in || SysFseek(in, STP_DATA_OFFSET))
+  {
+    if (in) fclose(in);
+    MTX_ERROR2("%s: %E", storedProductFile(ngs, sl->dim, file), MTX_ERR_FILEFMT);
+    return 1;
+  }
+  r = copySliceRows(ngs, in, fp, rows);
+  fclose(in);
+  return r;
+}
+
+/****
+ * 1 on error
+ ***************************************************************************/
+int restoreExpansionProducts(ngs_t *ngs, group_t *group, FILE *fp)
+/* Reads back what saveExpansionProducts wrote, replacing what was stored in
+ * that dimension */
+{
+  long head[2], rows;
+  slice_t *sl;
+  int r = 0;
+  if (fread(head, sizeof(long), 2, fp) != 2)
+  {
+    MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+    return 1;
+  }
+  if (head[0] == NONE) return 0;
+  sl = newStoredSlice(ngs, group, head[0], head[1]);
+  if (!sl) return 1;
+  rows = head[1] * (ngs->r + ngs->s);
+  if (sl->where == SLICE_IN_RAM)
+  {
+    if (fread(sl->data, FfCurrentRowSize, rows, fp) != (size_t) rows)
+    {
+      MTX_ERROR1("%E", MTX_ERR_FILEFMT);
+      return 1;
+    }
+    return 0;
+  }
+  r = copySliceRows(ngs, fp, sl->fp, rows);
+  fclose(sl->fp);
+  sl->fp = NULL;
+  return r;
 }
 
 /******************************************************************************/
@@ -308,37 +823,70 @@ static long smallestDimensionOfReduced(ngs_t *ngs)
   return ngs->firstReduced->gv->dim;
 }
 
+/******************************************************************************/
+static long cacheSlotOfBlock(ngs_t *ngs, long block)
+/* NONE if block is not cached */
+{
+  long slot;
+  for (slot = 0; slot < ngs->cacheSize; slot++)
+    if (ngs->cachedBlock[slot] == block) return slot;
+  return NONE;
+}
+
+/******************************************************************************/
+static long leastRecentlyUsedCacheSlot(ngs_t *ngs)
+{
+  long slot, lru = 0;
+  for (slot = 1; slot < ngs->cacheSize; slot++)
+    if (ngs->cacheUsed[slot] < ngs->cacheUsed[lru]) lru = slot;
+  return lru;
+}
+
+/******************************************************************************/
+static inline PTR cachedBlockRow(ngs_t *ngs, long slot, long row)
+{
+  return ngs->thisBlock +
+    ((size_t) slot * ngs->blockSize * (ngs->r + ngs->s) + row) * FfCurrentRowSize;
+}
+
 /*****
  * 1 on error
  **************************************************************************/
-static int loadBlock(ngs_t *ngs, long block)
+static int loadBlock(ngs_t *ngs, long block, long slot)
+/* SLICE_IN_FILE, when the file could not be mapped */
 {
-  FILE *fp;
+  char file[MAXLINE];
+  FILE *fp = ngs->sliceLoaded->fp;
   long nor = ngs->r + ngs->s;
-  long totrows, blen = ngs->blockSize;
+  long blen = ngs->blockSize;
   long lastblock = (ngs->nops - 1) / ngs->blockSize;
   if (block == lastblock)
     blen = 1 + (ngs->nops-1) % ngs->blockSize;
-  fp = readhdrplus(storedProductFile(ngs, ngs->dimLoaded), NULL, &totrows,
-    NULL);
-  if (!fp) {printf("readhdrplus returns NULL\n"); return 1;}
-  if (totrows != nor * ngs->nops)
+  if (ngs->sliceLoaded->nops != ngs->nops)
   {
     MTX_ERROR1("incorrect number of rows: %E", MTX_ERR_INCOMPAT);
     return 1;
   }
-  /*FfSeekRow(fp, 1 + block * nor * ngs->blockSize);*/
-  totrows = FfCurrentRowSizeIo*(block * nor * ngs->blockSize);
-  if (totrows) SysFseekRelative(fp, totrows);
-  register long blennor = blen * nor;
-  totrows = FfReadRows(fp, ngs->thisBlock, blennor);
-  if (totrows != blennor)
-  { fclose(fp);
-    MTX_ERROR2("%s: %E", storedProductFile(ngs, ngs->dimLoaded), MTX_ERR_FILEFMT);
+  if (!ngs->thisBlock)
+  {
+    ngs->thisBlock = FfAlloc(ngs->cacheSize * ngs->blockSize * nor);
+    if (!ngs->thisBlock)
+    { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+      return 1;
+    }
+  }
+  ngs->cachedBlock[slot] = NONE;
+  register size_t blennor = blen * nor;
+  if (SysFseek(fp, STP_DATA_OFFSET +
+        (long) FfCurrentRowSize * block * nor * ngs->blockSize) ||
+      fread(cachedBlockRow(ngs, slot, 0), FfCurrentRowSize, blennor, fp) !=
+        blennor)
+  {
+    MTX_ERROR2("%s: %E", storedProductFile(ngs, ngs->dimLoaded, file), MTX_ERR_FILEFMT);
     return 1;
   }
-  fclose(fp);
-  ngs->blockLoaded = block;
+  ngs->cachedBlock[slot] = block;
+  ngs->stats.sliceBytesRead += blennor * FfCurrentRowSize;
   return 0;
 }
 
@@ -356,66 +904,182 @@ PTR nodeVector(ngs_t *ngs, group_t *group, modW_t *node)
   }
   if (i == SCALAR_MULTIPLE)
     w = node->divisor->gv->w;
+  else if (ngs->sliceLoaded->where == SLICE_IN_RAM || ngs->sliceLoaded->map)
+  {
+    if (ngs->sliceLoaded->nops != ngs->nops)
+    {
+      MTX_ERROR1("incorrect number of products: %E", MTX_ERR_INCOMPAT);
+      return NULL;
+    }
+    w = storedSliceRow(ngs->sliceLoaded, i * (ngs->r + ngs->s));
+  }
   else
   {
     long block = i / ngs->blockSize;
     long pos = i % ngs->blockSize;
     long nor = ngs->r + ngs->s;
-    if (ngs->blockLoaded != block)
-    { if (loadBlock(ngs, block)) return NULL;
+    long slot = cacheSlotOfBlock(ngs, block);
+    if (slot == NONE)
+    {
+      ngs->cacheMisses++;
+      slot = leastRecentlyUsedCacheSlot(ngs);
+      if (loadBlock(ngs, block, slot)) return NULL;
     }
-    w = FfGetPtr(ngs->thisBlock, pos * nor);
+    else ngs->cacheHits++;
+    ngs->cacheUsed[slot] = ++ngs->cacheClock;
+    w = cachedBlockRow(ngs, slot, pos * nor);
   }
   return w;
 }
 
-static inline void commenceNewDimension(ngs_t *ngs, group_t *group, int dim)
+/******************************************************************************/
+boolean nodeVectorLoaded(ngs_t *ngs, modW_t *node)
+/* true if nodeVector can answer for node without loading a block,
+ * i.e. without possibly invalidating pointers it returned before */
 {
-    (ngs)->dimLoaded = dim;
-    updateWordStatusData((ngs),(group)), (group);
-    (ngs)->blockLoaded = NONE;
+  long i = node->status;
+  if (i == SCALAR_MULTIPLE) return true;
+  if (i < 0) return false;
+  if (ngs->sliceLoaded->where == SLICE_IN_RAM || ngs->sliceLoaded->map)
+    return true;
+  return (cacheSlotOfBlock(ngs, i / ngs->blockSize) != NONE) ? true : false;
+}
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int commenceNewDimension(ngs_t *ngs, group_t *group, int dim)
+{
+    ngs->sliceLoaded = storedSlice(ngs, dim);
+    if (!ngs->sliceLoaded)
+    { MTX_ERROR1("No stored products in dimension %d", dim);
+      return 1;
+    }
+    if (loadStoredSlice(ngs, ngs->sliceLoaded)) return 1;
+    ngs->dimLoaded = dim;
+    if (updateWordStatusData(ngs, group)) return 1;
+    forgetCachedBlocks(ngs);
+    return 0;
 }
 
 
 /*****
  * 1 on error
  **************************************************************************/
-static int calculateNextProducts(ngs_t *ngs, group_t *group)
+static int multiplyProductBatch(ngs_t *ngs, group_t *group, modW_t **node,
+  long *arrow, long *where, long num, PTR dest)
+/* Puts node[i] * arrow[i] at row nor * i of dest, for i < num.
+ * All vectors to be multiplied by the same arrow are stacked, so that there
+ * is one big multiplication per arrow rather than one small one per node.
+ * The stack is built in theseProds; the products land in prodScratch and
+ * are then moved into place. dest may be theseProds. */
+{
+  long nor = ngs->r + ngs->s;
+  long start[MAXARROW], fill[MAXARROW];
+  register long i, a;
+  PTR w = NULL;
+  for (a = 0; a < group->arrows; a++) fill[a] = 0;
+  for (i = 0; i < num; i++) fill[arrow[i]]++;
+  for (a = 0, i = 0; a < group->arrows; i += fill[a], fill[a++] = 0)
+    start[a] = i;
+  for (i = 0; i < num; i++)
+  {
+    if (i == 0 || node[i] != node[i-1])
+    {
+      w = nodeVector(ngs, group, node[i]);
+      if (!w) return 1;
+    }
+    a = arrow[i];
+    where[i] = start[a] + fill[a]++;
+    memcpy(FfGetPtr(ngs->theseProds, nor * where[i]), w,
+      FfCurrentRowSize * nor);
+  }
+  for (a = 0; a < group->arrows; a++)
+  {
+    if (!fill[a]) continue;
+    if (multiply(FfGetPtr(ngs->theseProds, nor * start[a]), group->action[a],
+        FfGetPtr(ngs->prodScratch, nor * start[a]), nor * fill[a])) return 1;
+    countMultiplication(ngs, nor * fill[a]);
+  }
+  for (i = 0; i < num; i++)
+    memcpy(dest + (size_t) nor * i * FfCurrentRowSize,
+      FfGetPtr(ngs->prodScratch, nor * where[i]), FfCurrentRowSize * nor);
+  return 0;
+}
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int storeProductBatch(ngs_t *ngs, group_t *group, slice_t *sl,
+  long first, modW_t **node, long *arrow, long *where, long num)
+/* Products number first, ..., first + num - 1 of sl */
+{
+  long nor = ngs->r + ngs->s;
+  if (sl->where == SLICE_IN_RAM)
+    return multiplyProductBatch(ngs, group, node, arrow, where, num,
+      storedSliceRow(sl, first * nor));
+  if (multiplyProductBatch(ngs, group, node, arrow, where, num,
+      ngs->theseProds)) return 1;
+  if (fwrite(ngs->theseProds, FfCurrentRowSize, nor * num, sl->fp) !=
+      (size_t) (nor * num))
+  {
+    MTX_ERROR1("expected nor * offset: %E", MTX_ERR_INCOMPAT);
+    return 1;
+  }
+  ngs->stats.sliceBytesWritten += nor * num * FfCurrentRowSize;
+  return 0;
+}
+
+/******************************************************************************/
+static long numberOfNextProducts(ngs_t *ngs, group_t *group)
+/* Assumes ngs->dimLoaded is set */
+{
+  long d = ngs->dimLoaded;
+  register long a;
+  long pat, blo;
+  long nops = 0;
+  modW_t *node;
+  for (blo = 0; blo < ngs->r; blo++)
+    for (pat = group->dS[d]; pat < group->dS[d+1]; pat++)
+    {
+      node = ngs->proot[blo] + pat;
+      if (node->status == NO_DIVISOR) continue;
+      for (a = 0; a < group->arrows; a++)
+        if (group->root[pat].child[a]) nops++;
+    }
+  return nops;
+}
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int calculateProductsInBatches(ngs_t *ngs, group_t *group, slice_t *sl,
+  modW_t **batchNode, long *batchArrow, long *batchWhere)
 /* Assumes ngs->dimLoaded is set */
 {
   long d = ngs->dimLoaded;
-  /* long lS = layerSize(ngs, group, d); */
   register long a;
   long pat;
   long blo;
-  long nor = ngs->r + ngs->s;
   register long nops = 0;
   register long offset = 0;
   modW_t *node;
-  PTR w, dest;
-  FILE *fp = writehdrplus(storedProductFile(ngs, d+1), FfOrder, 0, group->nontips);
-  if (!fp) return 1;
   for (blo = 0; blo < ngs->r; blo++)
     for (pat = group->dS[d]; pat < group->dS[d+1]; pat++)
     {
       node = ngs->proot[blo] + pat;
       if (node->status == NO_DIVISOR) continue;
-      w = nodeVector(ngs, group, node);
-      if (!w) return 1;
       for (a = 0; a < group->arrows; a++)
       {
-        if (node->child[a])
+        if (group->root[pat].child[a])
         {
-          dest = FfGetPtr(ngs->theseProds, nor * offset++);
-          if (multiply(w, group->action[a], dest, nor)) return 1;
-          nops++;
+          batchNode[offset] = node;
+          batchArrow[offset++] = a;
           if (offset == ngs->blockSize)
           {
-            if (FfWriteRows(fp, ngs->theseProds, nor * offset) != nor * offset)
-            { fclose(fp);
-              MTX_ERROR1("expected nor * offset: %E", MTX_ERR_INCOMPAT);
-              return 1;
-            }
+            if (storeProductBatch(ngs, group, sl, nops, batchNode, batchArrow,
+                batchWhere, offset)) return 1;
+            nops += offset;
             offset = 0;
           }
         }
@@ -423,25 +1087,63 @@ static int calculateNextProducts(ngs_t *ngs, group_t *group)
     }
   if (offset != 0)
   {
-    if (FfWriteRows(fp, ngs->theseProds, nor * offset) != nor * offset)
-    { fclose(fp);
-      MTX_ERROR1("expected nor * offset: %E", MTX_ERR_INCOMPAT);
-      return 1;
+    if (storeProductBatch(ngs, group, sl, nops, batchNode, batchArrow,
+        batchWhere, offset)) return 1;
+  }
+  return 0;
+}
+
+/*****
+ * 1 on error
+ **************************************************************************/
+static int calculateNextProducts(ngs_t *ngs, group_t *group)
+/* Assumes ngs->dimLoaded is set */
+{
+  long bs = ngs->blockSize;
+  modW_t **batchNode = (modW_t **) malloc(bs * sizeof(modW_t *));
+  long *batchArrow = (long *) malloc(bs * sizeof(long));
+  long *batchWhere = (long *) malloc(bs * sizeof(long));
+  slice_t *sl;
+  struct timespec start;
+  int r = 1;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (!batchNode || !batchArrow || !batchWhere)
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+  else
+  {
+    sl = newStoredSlice(ngs, group, ngs->dimLoaded + 1,
+      numberOfNextProducts(ngs, group));
+    if (sl)
+    {
+      r = calculateProductsInBatches(ngs, group, sl, batchNode, batchArrow,
+        batchWhere);
+      ngs->productsComputed += sl->nops;
+      if (sl->fp)
+      {
+        fclose(sl->fp);
+        sl->fp = NULL;
+      }
     }
   }
-  int r = alterhdrplus(fp, nops * nor);
-  fclose(fp);
+  if (batchNode) free(batchNode);
+  if (batchArrow) free(batchArrow);
+  if (batchWhere) free(batchWhere);
+  ngs->stats.seconds[PHASE_PRODUCTS] += secondsSince(&start);
   return r;
 }
 
 /****
  * 1 on error
  ***************************************************************************/
-static int createEmptySliceFile(ngs_t *ngs, group_t *group, long d)
+static int createEmptySlice(ngs_t *ngs, group_t *group, long d)
 {
-  FILE *fp = writehdrplus(storedProductFile(ngs, d), FfOrder, 0, group->nontips);
-  if (!fp) return 1;
-  fclose(fp);
+  slice_t *sl = newStoredSlice(ngs, group, d, 0);
+  if (!sl) return 1;
+  if (sl->fp)
+  {
+    fclose(sl->fp);
+    sl->fp = NULL;
+  }
   return 0;
 }
 
@@ -471,8 +1173,7 @@ int loadExpansionSlice(ngs_t *ngs, group_t *group)
   { MTX_ERROR1("something already loaded: %E", MTX_ERR_BADUSAGE);
     return 1;
   }
-  commenceNewDimension(ngs, group, ngs->expDim);
-  return 0;
+  return commenceNewDimension(ngs, group, ngs->expDim);
 }
 
 /*****
@@ -485,10 +1186,11 @@ int incrementSlice(ngs_t *ngs, group_t *group)
   { MTX_ERROR1("nothing loaded: %E", MTX_ERR_BADUSAGE);
     return 1;
   }
-  if (calculateNextProducts(ngs, group)) return 1;
+  if (ngs->keepSlices && storedSlice(ngs, n+1))
+    ngs->productsReused += storedSlice(ngs, n+1)->nops;
+  else if (calculateNextProducts(ngs, group)) return 1;
   if (destroyCurrentDimension(ngs)) return 1;
-  commenceNewDimension(ngs,group,n+1);
-  return 0;
+  return commenceNewDimension(ngs, group, n+1);
 }
 
 /*****
@@ -508,12 +1210,17 @@ int selectNewDimension(ngs_t *ngs, group_t *group, long dim)
     if (destroyCurrentDimensionIfAny(ngs)) return 1;
     if (loadExpansionSlice(ngs, group)) return 1;
   }
+  if (ngs->dimLoaded == NONE && ngs->keepSlices && storedSlice(ngs, dim))
+  {
+    ngs->productsReused += storedSlice(ngs, dim)->nops;
+    if (commenceNewDimension(ngs, group, dim)) return 1;
+  }
   if (ngs->dimLoaded == NONE)
   {
     n = smallestDimensionOfReduced(ngs);
     if (n == NONE || n > dim) n = dim;
-    if (createEmptySliceFile(ngs, group, n)) return 1;
-    commenceNewDimension(ngs, group, n); /* uWSD should set nops = 0 */
+    if (createEmptySlice(ngs, group, n)) return 1;
+    if (commenceNewDimension(ngs, group, n)) return 1; /* uWSD should set nops = 0 */
     if (ngs->nops != 0)
     { MTX_ERROR1("theoretical error: ngs->nops = %d\n",ngs->nops);
       return 1;
@@ -25,20 +25,35 @@
 #if !defined(__SLICE_DECLS_INCLUDED)    /* Include only once */
 #define __SLICE_DECLS_INCLUDED
 
+void setSliceMemoryBudget(size_t bytes);
+size_t sliceMemoryBudgetDefault(void);
+void setBlockCacheSize(long n);
+long blockCacheSizeDefault(void);
+void setBlockSize(long n);
+long blockSizeDefault(long nor);
+long calibrateBlockSize(group_t *group, long nor, char *stem);
+void freeStoredSlices(ngs_t *ngs);
 PTR nodeVector(ngs_t *ngs, group_t *group, modW_t *node);
-void freeGeneralVector(gV_t *gv);
-// gV_t *popGeneralVector(ngs_t *ngs);
+void *allocatePoolChunk(ngs_t *ngs, size_t bytes);
+void freePoolChunks(ngs_t *ngs);
+gV_t *popGeneralVector(ngs_t *ngs);
 void pushGeneralVector(ngs_t *ngs, gV_t *gv);
 int makeVectorMonic(ngs_t *ngs, gV_t *gv);
 int multiply(PTR row, Matrix_t *mat, PTR result, long r);
+void multiplyRows(PTR row, Matrix_t *mat, PTR result, long r);
+boolean nodeVectorLoaded(ngs_t *ngs, modW_t *node);
 int createWordForest(ngs_t *ngs, group_t *group);
 // void freeWordForest(ngs_t *ngs);
 int destroyCurrentDimension(ngs_t *ngs);
 int destroyCurrentDimensionIfAny(ngs_t *ngs);
 int destroyExpansionSliceFile(ngs_t *ngs);
+void keepStoredSlices(ngs_t *ngs);
+int removeKeptSlices(ngs_t *ngs);
 int selectNewDimension(ngs_t *ngs, group_t *group, long dim);
 int loadExpansionSlice(ngs_t *ngs, group_t *group);
 int incrementSlice(ngs_t *ngs, group_t *group);
+int saveExpansionProducts(ngs_t *ngs, FILE *fp);
+int restoreExpansionProducts(ngs_t *ngs, group_t *group, FILE *fp);
 
 void findLeadingMonomial(gV_t *gV, long r, group_t *group);
 
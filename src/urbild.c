@@ -24,6 +24,7 @@
 
 #include "nDiag.h"
 #include "slice_decls.h"
+#include "nBuchberger_decls.h"
 #include "fp_decls.h"
 #include "meataxe.h"
 
@@ -63,7 +64,7 @@ int saveMinimalGenerators(nFgs_t *nFgs, char *outfile, group_t *group)
 Matrix_t *getMinimalGenerators(nFgs_t *nFgs, group_t *group)
 {
   ngs_t *ngs = nFgs->ngs;
-  long nor = 0;
+  long nor = ngs->numHeadyReduced * ngs->r;
   long noc = group->nontips;
   long i;
   gV_t *gv;
@@ -71,18 +72,6 @@ Matrix_t *getMinimalGenerators(nFgs_t *nFgs, group_t *group)
   Matrix_t *OUT;
   PTR p;
   register char *b;
-  /* fp = writehdrplus(outfile, FfOrder, 0, group->nontips);
-   i.e. FfOrder is the fl, group->nontips is noc, and nor will be determined now:
-  */
-  for (rv = ngs->firstReduced; rv; rv = rv->next)
-  {
-    gv = rv->gv;
-    if (!gv->radical) /* i.e. this rv a min generator */
-    {
-      nor += ngs->r;
-    }
-  }
-  /* alterhdrplus(fp,nor);*/
   OUT = MatAlloc(FfOrder, nor, noc);
   p = (PTR)OUT->Data;
   for (rv = ngs->firstReduced; rv; rv = rv->next)
@@ -128,48 +117,67 @@ int saveUrbildGroebnerBasis(nRgs_t *nRgs, char *outfile, group_t *group)
   return r;
 }
 
+/****
+ * NULL on error
+ ***************************************************************************/
+char *urbildGroebnerBasisRows(nRgs_t *nRgs, long *nor)
+/* The rows that saveUrbildGroebnerBasis writes, in one block of *nor rows
+ * of FfCurrentRowSize bytes, to be freed by the caller */
+{
+  ngs_t *ngs = nRgs->ngs;
+  size_t t = ngs->r + ngs->s;
+  rV_t *rv;
+  char *rows, *p;
+  *nor = 0;
+  for (rv = ngs->firstReduced; rv; rv = rv->next) *nor += t;
+  rows = (char *) malloc((*nor) ? *nor * FfCurrentRowSize : 1);
+  if (!rows)
+  {
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  for (p = rows, rv = ngs->firstReduced; rv; rv = rv->next)
+  {
+    memcpy(p, rv->gv->w, t * FfCurrentRowSize);
+    p += t * FfCurrentRowSize;
+  }
+  return rows;
+}
+
+/******************************************************************************/
+static inline void countHeadyVector(ngs_t *ngs, gV_t *gv, long n)
+/* n = 1 when gv joins the reduced list or the unreduced heap, -1 when it
+ * leaves */
+{
+  if (gv->radical) return;
+  ngs->numHeady += n;
+  ngs->headyOfDim[gv->dim] += n;
+}
+
 /******************************************************************************/
 long numberOfHeadyVectors(ngs_t *ngs)
 {
-  rV_t *rv;
-  uV_t *uv;
-  long gens = 0;
-  for (rv = ngs->firstReduced; rv; rv = rv->next)
-    if (!rv->gv->radical) gens++;
-  for (uv = ngs->unreducedHeap; uv; uv = uv->next)
-    if (!uv->gv->radical) gens++;
-  return gens;
+  return ngs->numHeady;
 }
 
 /******************************************************************************/
 long dimensionOfDeepestHeady(ngs_t *ngs)
 {
-  rV_t *rv;
-  uV_t *uv;
-  long hd = 0;
-  for (rv = ngs->firstReduced; rv; rv = rv->next)
-    if (!rv->gv->radical && rv->gv->dim > hd) hd = rv->gv->dim;
-  for (uv = ngs->unreducedHeap; uv; uv = uv->next)
-    if (!uv->gv->radical && uv->gv->dim > hd) hd = uv->gv->dim;
+  long hd;
+  for (hd = ngs->numDims - 1; hd > 0 && !ngs->headyOfDim[hd]; hd--);
   return hd;
 }
 
 /******************************************************************************/
 static inline long numberOfReducedVectors(ngs_t *ngs)
 {
-  long n;
-  rV_t *rv;
-  for (n = 0, rv = ngs->firstReduced; rv; n++, rv = rv->next);
-  return n;
+  return ngs->numReduced;
 }
 
 /******************************************************************************/
 static inline long numberOfUnreducedVectors(ngs_t *ngs)
 {
-  long n;
-  uV_t *uv;
-  for (n = 0, uv = ngs->unreducedHeap; uv; n++, uv = uv->next);
-  return n;
+  return ngs->numUnreduced;
 }
 
 #if !defined(targetPnontips)
@@ -252,22 +260,53 @@ static ngs_t *ngsAllocation(long r, long s, group_t *group, char *stem)
   ngs->s = s;
   ngs->firstReduced = NULL;
   ngs->lastReduced = NULL;
+  ngs->numDims = group->maxlength + 1;
+  ngs->lastReducedIn = (rV_t **) calloc(ngs->numDims * r, sizeof(rV_t *));
+  ngs->headyOfDim = (long *) calloc(ngs->numDims, sizeof(long));
+  memset(&ngs->stats, 0, sizeof(ngsStats_t));
+  ngs->stats.reductionsOfDim =
+    (unsigned long *) calloc(ngs->numDims, sizeof(unsigned long));
+  if (!ngs->lastReducedIn || !ngs->headyOfDim || !ngs->stats.reductionsOfDim)
+  { free(ngs);
+    MTX_ERROR1("%E", MTX_ERR_NOMEM);
+    return NULL;
+  }
+  ngs->numReduced = 0;
+  ngs->numHeadyReduced = 0;
+  ngs->numHeady = 0;
   ngs->unreducedHeap = NULL;
+  ngs->numUnreduced = 0;
+  ngs->allocUnreduced = 0;
+  ngs->unreducedSeq = 0;
   ngs->pnontips = r * group->nontips;
   ngs->expDim = NOTHING_TO_EXPAND;
   ngs->targetRank = RANK_UNKNOWN;
-  ngs->gVwaiting = NULL;
+  ngs->freeGeneral = NULL;
+  ngs->freeUnreduced = NULL;
+  ngs->freeReduced = NULL;
+  ngs->poolChunks = NULL;
   if (createWordForest(ngs, group))
   { free(ngs);
     return NULL;
   }
   ngs->dimLoaded = NONE;
-  ngs->blockLoaded = NONE;
-  ngs->blockSize = BLOCK_SIZE;
-  ngs->thisBlock = FfAlloc(ngs->blockSize * (r + s));
+  ngs->slices = NULL;
+  ngs->sliceLoaded = NULL;
+  ngs->sliceMemory = 0;
+  ngs->sliceBudget = sliceMemoryBudgetDefault();
+  ngs->blockSize = blockSizeDefault(r + s);
+  ngs->thisBlock = NULL; /* allocated when first needed */
+  ngs->cacheSize = blockCacheSizeDefault();
+  ngs->cachedBlock = (long *) malloc(ngs->cacheSize * sizeof(long));
+  ngs->cacheUsed = (unsigned long *) malloc(ngs->cacheSize * sizeof(long));
+  ngs->cacheClock = ngs->cacheHits = ngs->cacheMisses = 0;
+  ngs->keepSlices = false;
+  ngs->productsComputed = ngs->productsReused = 0;
   ngs->theseProds = FfAlloc(ngs->blockSize * (r + s));
+  ngs->prodScratch = FfAlloc(ngs->blockSize * (r + s));
   ngs->w = FfAlloc(r + s);
-  if (!ngs->thisBlock || !ngs->theseProds || !ngs->w)
+  if (!ngs->cachedBlock || !ngs->cacheUsed || !ngs->theseProds ||
+      !ngs->prodScratch || !ngs->w)
   { free(ngs);
     MTX_ERROR1("%E", MTX_ERR_NOMEM);
     return NULL;
@@ -296,69 +335,53 @@ nFgs_t *nFgsAllocation(group_t *group, long r, char *stem)
   }
   nFgs->finished = false;
   nFgs->nRgsUnfinished = false;
-  nFgs->max_unfruitful = MAX_UNFRUITFUL;
+  nFgs->max_unfruitful = maxUnfruitfulDefault();
+  nFgs->rounds = nFgs->fruitfulRounds = 0;
+  nFgs->pnonAtFetch = NONE;
   return nFgs;
 }
 
 /******************************************************************************/
 void freeReducedVector(rV_t *rv, ngs_t *ngs)
+/* Returns rv and its vector to the pool of ngs */
 {
-  if (rv->gv) freeGeneralVector(rv->gv);
-  free(rv);
-  return;
-}
-
-/******************************************************************************/
-static void freeReducedVectors(rV_t *first, ngs_t *ngs)
-{
-  rV_t *rv, *next;
-  if (first && first->prev) first->prev->next = NULL;
-  for (rv = first; rv; rv = next)
-  {
-    next = rv->next;
-    freeReducedVector(rv, ngs);
-  }
-  return;
-}
-
-/******************************************************************************/
-void freeUnreducedVector(uV_t *uv)
-{
-  if (uv->gv) freeGeneralVector(uv->gv);
-  free(uv);
+  if (rv->gv) pushGeneralVector(ngs, rv->gv);
+  rv->next = ngs->freeReduced;
+  ngs->freeReduced = rv;
   return;
 }
 
 /******************************************************************************/
-static void freeUnreducedVectors(ngs_t *ngs)
+void freeUnreducedVector(uV_t *uv, ngs_t *ngs)
+/* Returns uv and its vector to the pool of ngs */
 {
-  uV_t *first = ngs->unreducedHeap;
-  uV_t *uv, *next;
-  if (first && first->prev) first->prev->next = NULL;
-  for (uv = first; uv; uv = next)
-  {
-    next = uv->next;
-    freeUnreducedVector(uv);
-  }
+  if (uv->gv) pushGeneralVector(ngs, uv->gv);
+  uv->next = ngs->freeUnreduced;
+  ngs->freeUnreduced = uv;
   return;
 }
 
 /******************************************************************************/
 void freeNgs(ngs_t *ngs)
 {
-  freeReducedVectors(ngs->firstReduced, ngs);
-  freeUnreducedVectors(ngs);
   if (ngs->proot)
   {
     // freeWordForest(ngs);
     modW_t **proot = ngs->proot;
-    free(proot[0][0].child);
     free(proot[0]);
     free(proot);
   }
-  if (ngs->gVwaiting) freeGeneralVector(ngs->gVwaiting);
+  freePoolChunks(ngs); /* all vectors, reduced or not */
+  if (ngs->unreducedHeap) free(ngs->unreducedHeap);
+  if (ngs->lastReducedIn) free(ngs->lastReducedIn);
+  if (ngs->headyOfDim) free(ngs->headyOfDim);
+  if (ngs->stats.reductionsOfDim) free(ngs->stats.reductionsOfDim);
+  freeStoredSlices(ngs);
   if (ngs->thisBlock) free(ngs->thisBlock);
+  if (ngs->cachedBlock) free(ngs->cachedBlock);
+  if (ngs->cacheUsed) free(ngs->cacheUsed);
   if (ngs->theseProds) free(ngs->theseProds);
+  if (ngs->prodScratch) free(ngs->prodScratch);
   if (ngs->w) free(ngs->w);
   free(ngs);
   return;
@@ -388,7 +411,15 @@ nRgs_t *nRgsAllocation(group_t *group, long r, long s, char *stem)
     free(nRgs);
     return NULL;
   }
-  nRgs->overshoot = MAX_OVERSHOOT;
+  nRgs->overshoot = maxOvershootDefault();
+  nRgs->rounds = nRgs->fruitfulRounds = nRgs->kernelRounds = 0;
+  nRgs->headyAttempts = 0;
+  nRgs->kernelGenerators = 0;
+  nRgs->seconds = nRgs->kernelSeconds = 0;
+  nRgs->roundLog[0] = '\0';
+  nRgs->checkpoint[0] = '\0';
+  nRgs->checkpointTime = 0;
+  nRgs->resumed = false;
   return nRgs;
 }
 
@@ -422,6 +453,13 @@ static boolean vectorLessThan(gV_t *w1, gV_t *w2)
   return false;
 }
 
+/******************************************************************************/
+static inline rV_t **lastReducedInRun(ngs_t *ngs, gV_t *gv)
+/* The reduced list is sorted by dim, then block: a sequence of runs */
+{
+  return ngs->lastReducedIn + gv->dim * ngs->r + gv->block;
+}
+
 /******************************************************************************/
 static rV_t *reducedSuccessor(ngs_t *ngs, rV_t *rv)
 {
@@ -474,10 +512,22 @@ static int lowerExpDimIfNecessary(ngs_t *ngs, long d)
 int insertReducedVector(ngs_t *ngs, rV_t *rv)
 /* See expansion routines for info on expDim */
 {
-  rV_t *base = ngs->lastReduced;
+  rV_t **run = lastReducedInRun(ngs, rv->gv);
+  rV_t *base = *run;
+  long i;
+  if (!base)
+  { /* nothing of this dim and block yet: goes after the previous run */
+    for (i = run - ngs->lastReducedIn - 1; i >= 0 && !ngs->lastReducedIn[i]; i--);
+    if (i >= 0) base = ngs->lastReducedIn[i];
+  }
+  /* Everything before the run is smaller than rv */
   while (base && vectorLessThan(base->gv, rv->gv))
     base = base->prev;
   insertReducedVectorAfter(ngs, base, rv);
+  if (base == *run || !*run) *run = rv;
+  ngs->numReduced++;
+  if (!rv->gv->radical) ngs->numHeadyReduced++;
+  countHeadyVector(ngs, rv->gv, 1);
   rv->expDim = rv->gv->dim;
   return lowerExpDimIfNecessary(ngs, rv->expDim);
 }
@@ -485,7 +535,14 @@ int insertReducedVector(ngs_t *ngs, rV_t *rv)
 /******************************************************************************/
 void unlinkReducedVector(ngs_t *ngs, rV_t *rv)
 {
+  rV_t **run = lastReducedInRun(ngs, rv->gv);
   rV_t *rv1;
+  if (*run == rv)
+    *run = (rv->prev && rv->prev->gv->dim == rv->gv->dim &&
+      rv->prev->gv->block == rv->gv->block) ? rv->prev : NULL;
+  ngs->numReduced--;
+  if (!rv->gv->radical) ngs->numHeadyReduced--;
+  countHeadyVector(ngs, rv->gv, -1);
   rv1 = rv->prev;
   if (rv1 == NULL)
     ngs->firstReduced = rv->next;
@@ -505,49 +562,101 @@ void unlinkReducedVector(ngs_t *ngs, rV_t *rv)
  **************************************************************************/
 uV_t *unreducedVector(ngs_t *ngs, gV_t *gv)
 {
-  uV_t *uv = (uV_t *) malloc(sizeof(uV_t));
-  if (!uv)
-      {
-          MTX_ERROR1("%E", MTX_ERR_NOMEM);
-          return NULL;
-      }
-  uv->gv = gv; uv->prev = NULL; uv->next = NULL;
+  uV_t *uv;
+  register long i;
+  if (!ngs->freeUnreduced)
+  {
+    uv = (uV_t *) allocatePoolChunk(ngs, VECTOR_POOL_CHUNK * sizeof(uV_t));
+    if (!uv) return NULL;
+    for (i = 0; i < VECTOR_POOL_CHUNK; i++)
+      freeUnreducedVector(uv + i, ngs);
+  }
+  uv = ngs->freeUnreduced;
+  ngs->freeUnreduced = uv->next;
+  uv->gv = gv; uv->pos = NONE; uv->next = NULL;
   return uv;
 }
 
 /******************************************************************************/
-uV_t *unreducedSuccessor(ngs_t *ngs, uV_t *uv)
+static inline boolean unreducedPrecedes(uV_t *uv1, uV_t *uv2)
+/* The order in which firstUnreducedVector hands them out: the reverse of
+ * vectorLessThan, and among equals the one inserted last comes first */
 {
-  return (uv == NULL) ? ngs->unreducedHeap : uv->next;
+  if (vectorLessThan(uv2->gv, uv1->gv)) return true;
+  if (vectorLessThan(uv1->gv, uv2->gv)) return false;
+  return (uv1->seq > uv2->seq) ? true : false;
 }
 
 /******************************************************************************/
-static void insertUnreducedVectorAfter(ngs_t *ngs, uV_t *base, uV_t *uv)
+static inline void placeUnreducedVector(ngs_t *ngs, uV_t *uv, long pos)
 {
-  uV_t *next = unreducedSuccessor(ngs, base);
-  uv->prev = base;
-  uv->next = next;
-  if (next != NULL)
-    next->prev = uv;
-  if (base == NULL)
-    ngs->unreducedHeap = uv;
-  else
-    base->next = uv;
+  ngs->unreducedHeap[pos] = uv;
+  uv->pos = pos;
+}
+
+/******************************************************************************/
+static void siftUnreducedVectorUp(ngs_t *ngs, uV_t *uv, long pos)
+{
+  register long parent;
+  while (pos > 0)
+  {
+    parent = (pos - 1) / 2;
+    if (!unreducedPrecedes(uv, ngs->unreducedHeap[parent])) break;
+    placeUnreducedVector(ngs, ngs->unreducedHeap[parent], pos);
+    pos = parent;
+  }
+  placeUnreducedVector(ngs, uv, pos);
   return;
 }
 
 /******************************************************************************/
-void insertUnreducedVector(ngs_t *ngs, uV_t *uv)
-{
-  register uV_t *base = NULL;
-  register uV_t *succ;
-  while ((succ = unreducedSuccessor(ngs,base)) &&
-    vectorLessThan(uv->gv, succ->gv))
-    base = succ;
-  insertUnreducedVectorAfter(ngs, base, uv);
+static void siftUnreducedVectorDown(ngs_t *ngs, uV_t *uv, long pos)
+{
+  register long child;
+  register long n = ngs->numUnreduced;
+  uV_t **heap = ngs->unreducedHeap;
+  while ((child = 2 * pos + 1) < n)
+  {
+    if (child + 1 < n && unreducedPrecedes(heap[child+1], heap[child]))
+      child++;
+    if (!unreducedPrecedes(heap[child], uv)) break;
+    placeUnreducedVector(ngs, heap[child], pos);
+    pos = child;
+  }
+  placeUnreducedVector(ngs, uv, pos);
   return;
 }
 
+/******************************************************************************/
+uV_t *firstUnreducedVector(ngs_t *ngs)
+/* NULL if there are none. Otherwise the one of smallest length, then block,
+ * then column, radical before heady: the order of the Aufnahme sweeps */
+{
+  return (ngs->numUnreduced) ? ngs->unreducedHeap[0] : NULL;
+}
+
+/*****
+ * 1 on error
+ **************************************************************************/
+int insertUnreducedVector(ngs_t *ngs, uV_t *uv)
+{
+  if (ngs->numUnreduced == ngs->allocUnreduced)
+  {
+    long alloc = (ngs->allocUnreduced) ? 2 * ngs->allocUnreduced : 256;
+    uV_t **heap = (uV_t **) realloc(ngs->unreducedHeap, alloc * sizeof(uV_t *));
+    if (!heap)
+    { MTX_ERROR1("%E", MTX_ERR_NOMEM);
+      return 1;
+    }
+    ngs->unreducedHeap = heap;
+    ngs->allocUnreduced = alloc;
+  }
+  uv->seq = ngs->unreducedSeq++;
+  siftUnreducedVectorUp(ngs, uv, ngs->numUnreduced++);
+  countHeadyVector(ngs, uv->gv, 1);
+  return 0;
+}
+
 /*****
  * 1 on error
  **************************************************************************/
@@ -555,37 +664,40 @@ int insertNewUnreducedVector(ngs_t *ngs, gV_t *gv)
 {
   uV_t *uv = unreducedVector(ngs, gv);
   if (!uv) return 1;
-  insertUnreducedVector(ngs, uv);
-  return 0;
+  return insertUnreducedVector(ngs, uv);
 }
 
 /******************************************************************************/
 void unlinkUnreducedVector(ngs_t *ngs, uV_t *uv)
 {
-  uV_t *uv1;
-  uv1 = uv->prev;
-  if (uv1 == NULL)
-    ngs->unreducedHeap = uv->next;
+  long pos = uv->pos;
+  uV_t *last = ngs->unreducedHeap[--ngs->numUnreduced];
+  countHeadyVector(ngs, uv->gv, -1);
+  uv->pos = NONE;
+  if (last == uv) return;
+  if (pos > 0 && unreducedPrecedes(last, ngs->unreducedHeap[(pos - 1) / 2]))
+    siftUnreducedVectorUp(ngs, last, pos);
   else
-    uv1->next = uv->next;
-  uv1 = uv->next;
-  if (uv1 != NULL)
-    uv1->prev = uv->prev;
-  uv->prev = NULL; uv->next = NULL;
+    siftUnreducedVectorDown(ngs, last, pos);
   return;
 }
 
 /*****
  * NULL on error
  **************************************************************************/
-rV_t *reducedVector(gV_t *gv, group_t *group)
+rV_t *reducedVector(gV_t *gv, group_t *group, ngs_t *ngs)
 {
-  rV_t *rv = (rV_t *) malloc(sizeof(rV_t));
-  if (!rv)
-      {
-          MTX_ERROR1("%E", MTX_ERR_NOMEM);
-          return NULL;
-      }
+  rV_t *rv;
+  register long i;
+  if (!ngs->freeReduced)
+  {
+    rv = (rV_t *) allocatePoolChunk(ngs, VECTOR_POOL_CHUNK * sizeof(rV_t));
+    if (!rv) return NULL;
+    for (i = 0; i < VECTOR_POOL_CHUNK; i++)
+      freeReducedVector(rv + i, ngs);
+  }
+  rv = ngs->freeReduced;
+  ngs->freeReduced = rv->next;
   rv->gv = gv;
   rv->node = NULL; rv->next = NULL; rv->prev = NULL;
   return rv;
@@ -33,6 +33,7 @@ void freeNRgs(nRgs_t *nRgs);
 
 int saveMinimalGenerators(nFgs_t *nFgs, char *outfile, group_t *group);
 int saveUrbildGroebnerBasis(nRgs_t *nRgs, char *outfile, group_t *group);
+char *urbildGroebnerBasisRows(nRgs_t *nRgs, long *nor);
 
 Matrix_t *getMinimalGenerators(nFgs_t *nFgs, group_t *group);
 
@@ -44,17 +45,17 @@ void processNewFlaggedGenerator(nFgs_t *nFgs, PTR w, group_t *group);
 
 void unlinkReducedVector(ngs_t *ngs, rV_t *rv);
 // long headyDim(nFgs_t *nFgs);
-void insertUnreducedVector(ngs_t *ngs, uV_t *uv);
-uV_t *unreducedSuccessor(ngs_t *ngs, uV_t *uv);
+int insertUnreducedVector(ngs_t *ngs, uV_t *uv);
+uV_t *firstUnreducedVector(ngs_t *ngs);
 void freeReducedVector(rV_t *rv, ngs_t *ngs);
-rV_t *reducedVector(gV_t *gv, group_t *group);
+rV_t *reducedVector(gV_t *gv, group_t *group, ngs_t *ngs);
 long numberOfHeadyVectors(ngs_t *ngs);
 long dimensionOfDeepestHeady(ngs_t *ngs);
 int insertNewUnreducedVector(ngs_t *ngs, gV_t *gv);
 int insertReducedVector(ngs_t *ngs, rV_t *rv);
 gV_t *duplicate_gVtmp(ngs_t *ngs, boolean radical);
 void unlinkUnreducedVector(ngs_t *ngs, uV_t *uv);
-void freeUnreducedVector(uV_t *uv);
+void freeUnreducedVector(uV_t *uv, ngs_t *ngs);
 uV_t *unreducedVector(ngs_t *ngs, gV_t *gv);
 
 int nRgsInitializeVectors(nRgs_t *nRgs, PTR im, PTR pre, long n,